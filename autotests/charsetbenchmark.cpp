@@ -0,0 +1,113 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <KMime/Content>
+
+#include <QTest>
+
+#include <codecs.cpp>
+
+using namespace Qt::Literals;
+using namespace KMime;
+
+// a mix of charsets as found in a typical mailbox, including ones not natively supported by QStringConverter
+static const char *const charsets[] = {
+    "utf-8", "us-ascii", "iso-8859-1", "iso-8859-15", "windows-1252", "koi8-r", "shift_jis", "big5", "gb2312", "utf-8",
+};
+
+class CharsetBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    QList<QByteArray> m_charsets;
+    QList<QByteArray> m_texts;
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        const auto text = u"Grüße, Привет, こんにちは, 你好 – 1234567890"_s;
+        for (const auto charset : charsets) {
+            QStringEncoder encoder(charset);
+            if (!encoder.isValid()) {
+                continue;
+            }
+            m_charsets.push_back(charset);
+            m_texts.push_back(encoder.encode(text));
+        }
+        QVERIFY(!m_charsets.isEmpty());
+    }
+
+    void testCachedDecoderState()
+    {
+        // a dangling incomplete sequence must not leak into the next use
+        QCOMPARE(cachedDecoder("utf-8").decode("abc\xc3"), u"abc"_s);
+        QCOMPARE(cachedDecoder("utf-8").decode("\xa4"), QString(QChar::ReplacementCharacter));
+        QVERIFY(!cachedDecoder("x-kmime-bogus").isValid());
+        QVERIFY(!cachedEncoder("x-kmime-bogus").isValid());
+        QVERIFY(makeDecoder("utf-8").isValid());
+    }
+
+    void testFreshDecoders()
+    {
+        QBENCHMARK {
+            for (qsizetype i = 0; i < m_charsets.size(); ++i) {
+                QStringDecoder decoder(m_charsets[i].constData());
+                QVERIFY(!decoder.decode(m_texts[i]).isEmpty());
+            }
+        }
+    }
+
+    void testCachedDecoders()
+    {
+        QBENCHMARK {
+            for (qsizetype i = 0; i < m_charsets.size(); ++i) {
+                QVERIFY(!cachedDecoder(m_charsets[i]).decode(m_texts[i]).isEmpty());
+            }
+        }
+    }
+
+    void testFreshEncoders()
+    {
+        const auto text = u"Grüße"_s;
+        QBENCHMARK {
+            for (const auto &charset : std::as_const(m_charsets)) {
+                QStringEncoder encoder(charset.constData());
+                QVERIFY(!encoder.encode(text).isEmpty());
+            }
+        }
+    }
+
+    void testCachedEncoders()
+    {
+        const auto text = u"Grüße"_s;
+        QBENCHMARK {
+            for (const auto &charset : std::as_const(m_charsets)) {
+                QVERIFY(!cachedEncoder(charset).encode(text).isEmpty());
+            }
+        }
+    }
+
+    void testDecodedText()
+    {
+        std::vector<std::unique_ptr<Content>> contents;
+        for (qsizetype i = 0; i < m_charsets.size(); ++i) {
+            auto c = std::make_unique<Content>();
+            c->contentType()->setMimeType("text/plain");
+            c->contentType()->setCharset(m_charsets[i]);
+            c->setBody(m_texts[i]);
+            contents.push_back(std::move(c));
+        }
+
+        QBENCHMARK {
+            for (const auto &c : contents) {
+                QVERIFY(!c->decodedText().isEmpty());
+            }
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(CharsetBenchmark)
+
+#include "charsetbenchmark.moc"
@@ -73,6 +73,24 @@ void ContentIndexTest::testContent()
     QCOMPARE(c1->indexForContent(c121), ContentIndex(u"2.1"));
     QCOMPARE(c121->index(), ContentIndex(u"2.1"));
 
+    // positions follow insertion and removal of siblings
+    auto c10ptr = std::make_unique<Content>();
+    const auto c10 = c10ptr.get();
+    c1->prependContent(std::move(c10ptr));
+    QCOMPARE(c10->index(), ContentIndex(u"1"));
+    QCOMPARE(c11->index(), ContentIndex(u"2"));
+    QCOMPARE(c121->index(), ContentIndex(u"3.1"));
+    QCOMPARE(c1->content(c121->index()), c121);
+    auto taken = c1->takeContent(c11);
+    QCOMPARE(taken.get(), c11);
+    QCOMPARE(c121->index(), ContentIndex(u"2.1"));
+    QCOMPARE(c1->indexForContent(c11), ContentIndex());
+    QCOMPARE(c11->index(), ContentIndex());
+    taken.reset();
+    delete c10;
+    QCOMPARE(c12->index(), ContentIndex(u"1"));
+    QCOMPARE(c12->indexForContent(c121), ContentIndex(u"1"));
+
     QCOMPARE(c1->indexForContent((Content *)nullptr), ContentIndex());
     delete c1;
 }
@@ -88,6 +106,17 @@ void ContentIndexTest::testNavigation()
     QCOMPARE(ci.pop(), 3u);
     QCOMPARE(ci.up(), 1u);
     QCOMPARE(ci.toString(), QLatin1StringView("2"));
+
+    ContentIndex deep(u"1.2.3.4.5.6.7.8.9.4294967295");
+    QCOMPARE(deep.size(), 10);
+    QCOMPARE(deep.at(0), 1u);
+    QCOMPARE(deep.at(9), 4294967295u);
+    QCOMPARE(deep.toString(), QLatin1StringView("1.2.3.4.5.6.7.8.9.4294967295"));
+    QCOMPARE(deep.pop(), 1u);
+    deep.push(1);
+    QCOMPARE(deep, ContentIndex(u"1.2.3.4.5.6.7.8.9.4294967295"));
+    QCOMPARE(qHash(deep), qHash(ContentIndex(u"1.2.3.4.5.6.7.8.9.4294967295")));
+    QVERIFY(qHash(ContentIndex(u"1.2")) != qHash(ContentIndex(u"2.1")));
 }
 
 
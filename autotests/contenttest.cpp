@@ -10,6 +10,7 @@
 #include <QTest>
 
 #include "content.h"
+#include "decodedcontentcache.h"
 #include "headers.h"
 #include "message.h"
 
@@ -261,6 +262,33 @@ void ContentTest::testEncodedContent()
 
 }
 
+void ContentTest::testEncodedBodyCache()
+{
+    Content c;
+    c.contentType()->setMimeType("application/octet-stream");
+    c.contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    c.setBody("foo bar");
+    QCOMPARE(c.encodedBody(), QByteArray("Zm9vIGJhcg==\n"));
+    QCOMPARE(c.encodedBody(), QByteArray("Zm9vIGJhcg==\n"));
+
+    // changing the body drops the cached form
+    c.setBody("bar foo");
+    QCOMPARE(c.encodedBody(), QByteArray("YmFyIGZvbw==\n"));
+
+    // so does changing the transfer encoding
+    c.contentTransferEncoding()->setEncoding(Headers::CEquPr);
+    QCOMPARE(c.encodedBody(), QByteArray("bar foo"));
+
+    // clones start without a cached encoded body but produce the same result
+    c.contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    QCOMPARE(c.encodedBody(), QByteArray("YmFyIGZvbw==\n"));
+    auto clone = c.clone();
+    QCOMPARE(clone->encodedBody(), QByteArray("YmFyIGZvbw==\n"));
+    clone->setBody("foo bar");
+    QCOMPARE(clone->encodedBody(), QByteArray("Zm9vIGJhcg==\n"));
+    QCOMPARE(c.encodedBody(), QByteArray("YmFyIGZvbw==\n"));
+}
+
 void ContentTest::testDecodedContent()
 {
     auto c = new Content();
@@ -287,7 +315,9 @@ void ContentTest::testDecodedText()
         c.setHeader(std::move(cte));
         c.setEncodedBody("YmFzZTY0LWVuY29kZWQgdGV4dA==");
         QCOMPARE(c.decodedText(), u"base64-encoded text"_s);
-        QCOMPARE(c.decodedBody(), "base64-encoded text\n");
+        // decodedText() doesn't change the Content, so this doesn't depend on calling it before
+        QCOMPARE(c.decodedBody(), "base64-encoded text");
+        QCOMPARE(c.encodedBody(), "YmFzZTY0LWVuY29kZWQgdGV4dA==");
     }
     {
         Content c{};
@@ -302,7 +332,91 @@ void ContentTest::testDecodedText()
         QCOMPARE(c.decodedText(), QString{});
         QCOMPARE(c.decodedBody(), "base64-encoded binary blob of encrypted text");
     }
+    {
+        Content c{};
+        auto cte = std::make_unique<Headers::ContentTransferEncoding>();
+        cte->setEncoding(Headers::CEbase64);
+        c.setHeader(std::move(cte));
+        // concatenated base64 blocks, decoding ends at the first padding
+        c.setEncodedBody("Zmlyc3Q=\nc2Vjb25k\n");
+        QCOMPARE(c.decodedBody(), "first");
+        QCOMPARE(c.decodedText(), QString::fromLatin1(c.decodedBody()));
+        QString chunks;
+        QVERIFY(c.decodedTextChunks([&chunks](QStringView chunk) {
+            chunks += chunk;
+        }));
+        QCOMPARE(chunks, c.decodedText());
+    }
+}
 
+void ContentTest::testDecodedTextChunks_data()
+{
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<Headers::contentEncoding>("encoding");
+    QTest::addColumn<bool>("isEncoded");
+
+    QTest::newRow("empty") << QByteArray() << Headers::CE8Bit << false;
+    QTest::newRow("short") << QByteArray("plain text\n") << Headers::CE8Bit << false;
+    QTest::newRow("newlines") << QByteArray("text\n\n\n") << Headers::CE8Bit << false;
+    QTest::newRow("spaces") << QByteArray("text \n \t\n") << Headers::CE8Bit << false;
+    QTest::newRow("truncated") << QByteArray("text \xe2\x82") << Headers::CE8Bit << false;
+    // multi-byte sequences split across chunks
+    QTest::newRow("long") << QByteArray("\xc3\xa4\xe2\x82\xac text\n").repeated(20000) << Headers::CE8Bit << false;
+    // trailing whitespace spanning several chunks
+    QTest::newRow("long trailing whitespace") << QByteArray("text") + QByteArray(" \n").repeated(100000) << Headers::CE8Bit << false;
+    // transfer encodings are removed chunk by chunk as well
+    QTest::newRow("long base64") << QByteArray("\xc3\xa4\xe2\x82\xac text\n").repeated(20000) << Headers::CEbase64 << false;
+    QTest::newRow("long quoted-printable") << QByteArray("\xc3\xa4\xe2\x82\xac text \n").repeated(20000) << Headers::CEquPr << false;
+    QTest::newRow("truncated base64") << QByteArray("text \xe2\x82") << Headers::CEbase64 << false;
+    // escape sequences cut off at the end of a chunk, including an invalid one
+    QTest::newRow("split quoted-printable escapes")
+        << QByteArray("a").repeated(64 * 1024 - 1) + "=Z" + QByteArray("b").repeated(64 * 1024 - 2) + "=C3=A4 text=\n=\n"
+        << Headers::CEquPr << true;
+}
+
+void ContentTest::testDecodedTextChunks()
+{
+    QFETCH(QByteArray, body);
+    QFETCH(Headers::contentEncoding, encoding);
+    QFETCH(bool, isEncoded);
+
+    Content c;
+    c.contentType()->setMimeType("text/plain");
+    c.contentType()->setCharset("utf-8");
+    c.contentTransferEncoding()->setEncoding(encoding);
+    if (isEncoded) {
+        c.setEncodedBody(body);
+    } else {
+        c.setBody(body);
+        if (encoding != Headers::CE8Bit) {
+            c.setEncodedBody(c.encodedBody());
+        }
+    }
+
+    for (const auto trimOption : {Content::NoTrim, Content::TrimNewlines, Content::TrimSpaces}) {
+        QString text;
+        int chunks = 0;
+        QVERIFY(c.decodedTextChunks([&](QStringView chunk) {
+            QVERIFY(!chunk.isEmpty());
+            text += chunk;
+            ++chunks;
+        }, trimOption));
+        QCOMPARE(text, c.decodedText(trimOption));
+        QVERIFY(chunks <= 2 * (c.encodedBody().size() / (64 * 1024) + 2));
+        if (QByteArrayView(QTest::currentDataTag()).startsWith("truncated")) {
+            // the cut off sequence isn't dropped
+            QVERIFY(text.startsWith(u"text "_s));
+            QVERIFY(text.endsWith(QChar::ReplacementCharacter));
+        }
+        if (QByteArrayView(QTest::currentDataTag()) == "split quoted-printable escapes") {
+            QVERIFY(text.endsWith(u"b\u00e4 text"_s));
+        }
+    }
+
+    c.contentType()->setMimeType("image/png");
+    QVERIFY(!c.decodedTextChunks([](QStringView) {
+        QFAIL("not a text part");
+    }));
 }
 
 void ContentTest::testMultipleHeaderExtraction()
@@ -932,4 +1046,213 @@ void ContentTest::testChildDeletion()
     QCOMPARE(parent.contents().size(), 0);
 }
 
+void ContentTest::testTreeWalk()
+{
+    const QByteArray data(
+        "Content-Type: multipart/mixed; boundary=\"outer\"\n"
+        "\n"
+        "--outer\n"
+        "Content-Type: multipart/alternative; boundary=\"inner\"\n"
+        "\n"
+        "--inner\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "plain\n"
+        "--inner\n"
+        "Content-Type: text/html\n"
+        "\n"
+        "<p>html</p>\n"
+        "--inner--\n"
+        "--outer\n"
+        "Content-Type: image/png\n"
+        "Content-Disposition: attachment; filename=\"a.png\"\n"
+        "\n"
+        "png\n"
+        "--outer\n"
+        "Content-Type: message/rfc822\n"
+        "\n"
+        "Subject: nested\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "nested body\n"
+        "--outer--\n");
+
+    auto msg = std::make_unique<KMime::Message>();
+    msg->setContent(data);
+    msg->parse();
+    QCOMPARE(msg->contents().size(), 3);
+
+    QCOMPARE(msg->textContent(), msg->content(ContentIndex(u"1.1")));
+    const auto attachments = msg->attachments();
+    QCOMPARE(attachments.size(), 2);
+    QCOMPARE(attachments[0], msg->content(ContentIndex(u"2")));
+    QCOMPARE(attachments[1], msg->content(ContentIndex(u"3")));
+    QVERIFY(KMime::hasAttachment(msg.get()));
+    QVERIFY(!KMime::hasInvitation(msg.get()));
+
+    // the encapsulated message is the only child of its container
+    const auto nested = msg->contents()[2]->bodyAsMessage();
+    QVERIFY(nested);
+    QCOMPARE(msg->content(ContentIndex(u"3.1")), static_cast<KMime::Content *>(nested.get()));
+    QCOMPARE(nested->index(), ContentIndex(u"3.1"));
+    QCOMPARE(nested->textContent(), static_cast<KMime::Content *>(nested.get()));
+}
+
+void ContentTest::testDeepClone()
+{
+    const QByteArray data(
+        "From: Jane Doe <jane@example.org>\n"
+        "To: john@example.org, \"Doe, Jim\" <jim@example.org>\n"
+        "Subject: =?utf-8?q?Gr=C3=BC=C3=9Fe?=\n"
+        "Date: Mon, 19 Oct 2026 10:00:00 +0200\n"
+        "Message-ID: <abc@example.org>\n"
+        "References: <a@example.org> <b@example.org>\n"
+        "X-Custom: custom value\n"
+        "MIME-Version: 1.0\n"
+        "Content-Type: multipart/mixed; boundary=\"outer\"\n"
+        "\n"
+        "--outer\n"
+        "Content-Type: text/plain; charset=\"utf-8\"\n"
+        "Content-Transfer-Encoding: quoted-printable\n"
+        "\n"
+        "Gr=C3=BC=C3=9Fe\n"
+        "--outer\n"
+        "Content-Type: message/rfc822\n"
+        "\n"
+        "Subject: nested\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "nested body\n"
+        "--outer--\n");
+
+    auto msg = std::make_unique<KMime::Message>();
+    msg->setContent(data);
+    msg->parse();
+
+    const auto text = msg->contents()[0]->decodedText();
+    const auto clone = msg->clone();
+    QCOMPARE(clone->encodedContent(), msg->encodedContent());
+    QCOMPARE(clone->headerByType("X-Custom")->as7BitString(), "custom value");
+    QCOMPARE(clone->headerByType("X-Custom")->type(), "X-Custom");
+    QCOMPARE(clone->header<Headers::To>()->mailboxes().size(), 2);
+    QCOMPARE(clone->header<Headers::Date>()->dateTime(), msg->header<Headers::Date>()->dateTime());
+    QCOMPARE(clone->header<Headers::Subject>()->rfc2047Charset(), msg->header<Headers::Subject>()->rfc2047Charset());
+
+    // the headers and the tree are not shared
+    clone->header<Headers::Subject>()->fromUnicodeString(u"changed"_s);
+    QCOMPARE(msg->header<Headers::Subject>()->asUnicodeString(), u"Grüße"_s);
+    QCOMPARE(clone->contents().size(), 2);
+    QCOMPARE(clone->contents()[0]->parent(), clone.get());
+    QCOMPARE(clone->contents()[1]->index(), ContentIndex(u"2"));
+    clone->contents()[0]->setBody("changed");
+    QCOMPARE(msg->contents()[0]->decodedText(), text);
+
+    const auto nested = msg->contents()[1]->bodyAsMessage();
+    const auto clonedNested = clone->contents()[1]->bodyAsMessage();
+    QVERIFY(clonedNested);
+    QVERIFY(clonedNested != nested);
+    QCOMPARE(clonedNested->parent(), clone->contents()[1]);
+    QCOMPARE(clonedNested->index(), ContentIndex(u"2.1"));
+    QCOMPARE(clonedNested->subject()->asUnicodeString(), u"nested"_s);
+}
+
+void ContentTest::testDecodedContentCache()
+{
+    DecodedContentCache::setBudget(1024 * 1024);
+    DecodedContentCache::resetStatistics();
+    QCOMPARE(DecodedContentCache::budget(), 1024 * 1024);
+
+    {
+        Content c;
+        c.contentTransferEncoding()->setEncoding(Headers::CEbase64);
+        c.contentType()->setMimeType("text/plain");
+        c.contentType()->setCharset("utf-8");
+        c.setEncodedBody("R3LDvMOfZQo=");
+
+        QCOMPARE(c.decodedText(), u"Grüße"_s);
+        QCOMPARE(c.decodedText(), u"Grüße"_s);
+        QCOMPARE(c.decodedBody(), "Grüße\n");
+        QCOMPARE(c.decodedBody(), "Grüße\n");
+        auto stats = DecodedContentCache::statistics();
+        QCOMPARE(stats.hits, 2u);
+        QCOMPARE(stats.misses, 2u);
+        QCOMPARE(stats.entries, 2);
+        QVERIFY(stats.bytes > 0);
+
+        // the cached text doesn't survive a change of the charset
+        c.contentType()->setCharset("iso-8859-1");
+        QCOMPARE(c.decodedText(), QString::fromLatin1("Gr\xc3\xbc\xc3\x9f" "e"));
+        QCOMPARE(DecodedContentCache::statistics().misses, 3u);
+
+        // nor of the body
+        c.setEncodedBody("YWJj");
+        QCOMPARE(DecodedContentCache::statistics().entries, 0);
+        QCOMPARE(c.decodedBody(), "abc");
+        QCOMPARE(DecodedContentCache::statistics().entries, 1);
+
+        // results exceeding the budget are not kept
+        DecodedContentCache::setBudget(2);
+        QCOMPARE(DecodedContentCache::statistics().entries, 0);
+        QCOMPARE(c.decodedBody(), "abc");
+        QCOMPARE(DecodedContentCache::statistics().entries, 0);
+
+        DecodedContentCache::setBudget(1024);
+        QCOMPARE(c.decodedBody(), "abc");
+        QCOMPARE(DecodedContentCache::statistics().entries, 1);
+    }
+    // deleting the Content drops its entries
+    QCOMPARE(DecodedContentCache::statistics().entries, 0);
+
+    DecodedContentCache::setBudget(0);
+    QCOMPARE(DecodedContentCache::budget(), 0);
+}
+
+void ContentTest::testParseHeaders()
+{
+    const QByteArray data =
+        "From: a@example.org\n"
+        "Subject: original\n"
+        "MIME-Version: 1.0\n"
+        "Content-Type: multipart/mixed; boundary=\"b\"\n"
+        "\n"
+        "--b\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "first\n"
+        "--b\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "second\n"
+        "--b--\n";
+
+    auto msg = std::make_unique<Message>();
+    msg->setContent(data);
+    msg->parse();
+    QCOMPARE(msg->contents().size(), 2);
+    const auto first = msg->contents().at(0);
+    const auto second = msg->contents().at(1);
+
+    // the parts are kept when only the head changes
+    msg->setHead(QByteArray(msg->head()).replace("Subject: original", "Subject: changed"));
+    msg->parseHeaders();
+    QCOMPARE(msg->subject()->asUnicodeString(), u"changed"_s);
+    QCOMPARE(msg->contents(), QList<Content *>({first, second}));
+    QCOMPARE(msg->contentType()->boundary(), "b");
+
+    // parts can be reparsed on their own
+    second->setContent("Content-Type: text/plain\n\nreplaced\n");
+    second->parse();
+    QCOMPARE(msg->contents(), QList<Content *>({first, second}));
+    QVERIFY(msg->encodedContent().contains("replaced"));
+    QVERIFY(!msg->encodedContent().contains("second"));
+
+    // a head which doesn't fit the parts anymore parses everything again
+    msg->setHead("Subject: changed\nContent-Type: text/plain\n");
+    msg->parseHeaders();
+    QVERIFY(msg->contents().isEmpty());
+    QVERIFY(msg->contentType()->isPlainText());
+    QVERIFY(msg->body().contains("--b\n"));
+    QVERIFY(msg->body().contains("replaced"));
+}
+
 #include "moc_contenttest.cpp"
@@ -17,8 +17,11 @@ private Q_SLOTS:
     void testExplicitMultipartGeneration();
     void testSetContent();
     void testEncodedContent();
+    void testEncodedBodyCache();
     void testDecodedContent();
     void testDecodedText();
+    void testDecodedTextChunks_data();
+    void testDecodedTextChunks();
     void testMultipartMixed();
     void testMultipleHeaderExtraction();
     /**
@@ -34,5 +37,9 @@ private Q_SLOTS:
     void testContentTypeMimetype();
     void testConstChildren();
     void testChildDeletion();
+    void testTreeWalk();
+    void testDeepClone();
+    void testDecodedContentCache();
+    void testParseHeaders();
 };
 
@@ -9,6 +9,7 @@
 #include <QTest>
 
 #include "headers.h"
+#include "headerparsing.h"
 
 using namespace Qt::Literals;
 using namespace KMime;
@@ -67,6 +68,17 @@ void HeaderTest::testIdentHeader()
     QEXPECT_FAIL("", "Parsing strips square brackets.", Continue);
     QCOMPARE(h->as7BitString(), QByteArray(ident));
     delete h;
+
+    // zero-copy access, including ids needing the full parser
+    h = new Headers::Generics::Ident();
+    h->from7BitString(QByteArray("<1234@local.machine.example> < 3456 @ (comment) example.net >, <\"foo bar\"@example.net>"));
+    const auto views = h->identifiersView();
+    QCOMPARE(views.size(), 3);
+    QCOMPARE(views[0].toByteArray(), QByteArray("1234@local.machine.example"));
+    QCOMPARE(views[1].toByteArray(), QByteArray("3456@example.net"));
+    QCOMPARE(views[2].toByteArray(), QByteArray("\"foo bar\"@example.net"));
+    QCOMPARE(h->identifiers(), QList<QByteArray>({"1234@local.machine.example", "3456@example.net", "\"foo bar\"@example.net"}));
+    delete h;
 }
 
 void HeaderTest::testAddressListHeader()
@@ -486,8 +498,19 @@ void HeaderTest::testParametrizedHeader()
     QCOMPARE(h->as7BitString(), QByteArray("boundary=\"simple boundary\""));
     delete h;
 
+    // case-insensitive key-names, sorted output, replacing and non-ASCII values
+    h = new Parametrized();
+    h->from7BitString("Name=b; FORMAT=flowed; X-Custom=\"a\"");
+    QCOMPARE(h->parameter("name"), QLatin1StringView("b"));
+    QCOMPARE(h->parameter("format"), QLatin1StringView("flowed"));
+    QCOMPARE(h->parameter("x-CUSTOM"), QLatin1StringView("a"));
+    h->setParameter(QByteArrayLiteral("NAME"), u"Grüße"_s);
+    h->setParameter(QByteArrayLiteral("Charset"), u"utf-8"_s);
+    QCOMPARE(h->parameter("Name"), u"Grüße"_s);
+    QCOMPARE(h->as7BitString(), QByteArray("charset=\"utf-8\"; format=\"flowed\"; name*=UTF-8''Gr%C3%BC%C3%9Fe; x-custom=\"a\""));
+    delete h;
+
     // TODO: test RFC 2047 encoded values
-    // TODO: test case-insensitive key-names
 }
 
 void HeaderTest::testContentDispositionHeader()
@@ -546,6 +569,13 @@ void HeaderTest::testContentDispositionHeader()
     QCOMPARE(h->disposition(), CDattachment);
     QCOMPARE(h->filename(), QString::fromUtf8("ЭтоВложениеСДлиннымИмемФайлаСовсемБезПробеловИЕщёРазЭтоВложениеСДлиннымИмемФайлаСовсемБезПробелов.txt"));
     delete h;
+
+    // out of order and mixed case sections, characters split across sections, unencoded sections
+    h = new ContentDisposition;
+    h->from7BitString("attachment; FILENAME*1*=%BC%C3%9Fe; filename*0*=utf-8'de'Gr%C3; Filename*2=.txt");
+    QCOMPARE(h->disposition(), CDattachment);
+    QCOMPARE(h->filename(), u"Grüße.txt"_s);
+    delete h;
 }
 
 void HeaderTest::testContentTypeHeader()
@@ -642,6 +672,23 @@ void HeaderTest::testContentTypeHeader()
     QCOMPARE(h->mimeType(), QByteArray("MULTIPART/MIXED"));
     QCOMPARE(h->mediaType(), QByteArray("MULTIPART"));
     QCOMPARE(h->subType(), QByteArray("MIXED"));
+
+    // classification follows changes of the mimetype
+    h->setMimeType("Text/HTML");
+    QVERIFY(!h->isMultipart());
+    QVERIFY(h->isText());
+    QVERIFY(h->isHTMLText());
+    QVERIFY(!h->isPlainText());
+    h->setMimeType("image/png");
+    QVERIFY(h->isImage());
+    QVERIFY(!h->isText());
+    h->from7BitString("message/partial; number=2; total=3");
+    QVERIFY(h->isPartial());
+    QVERIFY(!h->isImage());
+    h->from7BitString("");
+    QVERIFY(h->isEmpty());
+    QVERIFY(!h->isPartial());
+    QVERIFY(h->isPlainText());
     delete h;
 
 }
@@ -873,6 +920,21 @@ void HeaderTest::testDateHeader()
     QCOMPARE(h->dateTime().date(), QDate(2030, 4, 12));
     QCOMPARE(h->dateTime().time(), QTime(0, 0, 0));
     delete h;
+
+    // a date set through the API is returned as is
+    h = new Date;
+    const QDateTime localTime(QDate(2024, 3, 5), QTime(10, 20, 30, 456));
+    h->setDateTime(localTime);
+    QCOMPARE(h->dateTime(), localTime);
+    QCOMPARE(h->dateTime().timeSpec(), Qt::LocalTime);
+    QCOMPARE(h->dateTime().time().msec(), 456);
+    QCOMPARE(h->secsSinceEpoch(), localTime.toSecsSinceEpoch());
+    QCOMPARE(h->offsetFromUtc(), localTime.offsetFromUtc());
+    // parsing replaces it
+    h->from7BitString("Fri, 21 Nov 1997 09:55:06 -0600");
+    QCOMPARE(h->dateTime().time(), QTime(9, 55, 6));
+    QCOMPARE(h->dateTime().offsetFromUtc(), -6 * 3600);
+    delete h;
 }
 
 void HeaderTest::testLinesHeader()
@@ -1109,6 +1171,72 @@ void HeaderTest::testParseNextHeader()
 
     QVERIFY(!KMime::HeaderParsing::parseNextHeader(dataView));
     QVERIFY(dataView.isEmpty());
+
+    // folded field, empty first line, NUL byte in the name and =20 continuation
+    data = QByteArray("Subject: multi\n line\nTo:\n katie@kde.org\nX-F", 43) + QByteArray(1, '\0')
+        + "oo: bar\n=20baz\nFrom: konqi@kde.org";
+    dataView = data;
+
+    header = KMime::HeaderParsing::parseNextHeader(dataView);
+    QVERIFY(header);
+    QCOMPARE(header->type(), "Subject");
+    QCOMPARE(header->asUnicodeString(), QLatin1StringView("multi line"));
+
+    header = KMime::HeaderParsing::parseNextHeader(dataView);
+    QVERIFY(header);
+    QCOMPARE(header->type(), "To");
+    QCOMPARE(header->as7BitString(), "katie@kde.org");
+
+    header = KMime::HeaderParsing::parseNextHeader(dataView);
+    QVERIFY(header);
+    QCOMPARE(header->type(), "X-Foo");
+    QCOMPARE(header->as7BitString(), "bar baz");
+
+    header = KMime::HeaderParsing::parseNextHeader(dataView);
+    QVERIFY(header);
+    QCOMPARE(header->type(), "From");
+    QCOMPARE(header->as7BitString(), "konqi@kde.org");
+    QVERIFY(dataView.isEmpty());
+}
+
+void HeaderTest::testExtractAddresses()
+{
+    const QByteArray data(
+        "From: Konqi <Konqi@KDE.org>\n"
+        "Subject: To: nobody@kde.org\n"
+        "to: katie@kde.org,\n"
+        " Friends: \"Doe, John\" <john@example.org>, jane@example.org;\n"
+        "Cc: broken <\n"
+        "Bcc: \"Secret Admirer\"@Example.org (Who?)\n"
+        "\n"
+        "Cc: body@kde.org\n");
+
+    using HeaderParsing::AddressField;
+    QList<AddressField> fields;
+    QList<QByteArray> addrSpecs;
+    const auto sink = [&](AddressField field, QByteArrayView addrSpec) {
+        fields.push_back(field);
+        addrSpecs.push_back(addrSpec.toByteArray());
+    };
+
+    HeaderParsing::extractAddresses(data, AddressField::From | AddressField::To | AddressField::Cc | AddressField::Bcc, sink);
+    const QList<AddressField> expectedFields{AddressField::From, AddressField::To, AddressField::To, AddressField::To, AddressField::Bcc};
+    QVERIFY(fields == expectedFields);
+    const QList<QByteArray> expectedAddrSpecs{"konqi@kde.org", "katie@kde.org", "john@example.org", "jane@example.org", "\"secret admirer\"@example.org"};
+    QCOMPARE(addrSpecs, expectedAddrSpecs);
+
+    addrSpecs.clear();
+    HeaderParsing::extractAddresses(data, AddressField::Cc, sink);
+    QVERIFY(addrSpecs.isEmpty());
+
+    // the sink may scan another header while the first one is being scanned
+    addrSpecs.clear();
+    HeaderParsing::extractAddresses(data, AddressField::From, [&](AddressField field, QByteArrayView addrSpec) {
+        HeaderParsing::extractAddresses("Cc: nested@kde.org\n", AddressField::Cc, sink);
+        sink(field, addrSpec);
+    });
+    const QList<QByteArray> expectedNested{"nested@kde.org", "konqi@kde.org"};
+    QCOMPARE(addrSpecs, expectedNested);
 }
 
 #include "moc_headertest.cpp"
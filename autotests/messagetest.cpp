@@ -5,11 +5,17 @@
 */
 
 #include "messagetest.h"
+#include "messagestructuresummary.h"
+#include "sharedmessage.h"
 #include <QTest>
 #include <QDebug>
+#include <QDataStream>
 #include <QFile>
+#include <QThread>
 #include <codecs.cpp>
 
+#include <functional>
+
 using namespace Qt::Literals;
 using namespace KMime;
 
@@ -805,4 +811,293 @@ void MessageTest::testYenc()
     QCOMPARE(msg->contents()[1]->decodedBody(), refFile.readAll());
 }
 
+void MessageTest::testEncodedContentSize_data()
+{
+    QTest::addColumn<QString>("mailFile");
+
+    QTest::newRow("plain") << u"plain-text-body.mbox"_s;
+    QTest::newRow("multipart") << u"kmail-attachmentstatus.mbox"_s;
+    QTest::newRow("encapsulated") << u"simple-encapsulated.mbox"_s;
+    QTest::newRow("base64") << u"bug392239.mbox"_s;
+    QTest::newRow("uuencode") << u"uuencode-simple.mbox"_s;
+    QTest::newRow("yenc") << u"yenc-single-part.yenc"_s;
+}
+
+void MessageTest::testEncodedContentSize()
+{
+    QFETCH(QString, mailFile);
+
+    auto msg = readAndParseMailMut(mailFile);
+    QCOMPARE(msg->storageSize(), msg->encodedContent().size());
+    QCOMPARE(msg->encodedContentSize(NewlineType::CRLF), msg->encodedContent(NewlineType::CRLF).size());
+
+    // with decoded bodies that need to be encoded
+    for (auto c : msg->contents()) {
+        if (!c->contentType()->isMultipart() && !c->bodyIsMessage()) {
+            const auto body = c->decodedBody();
+            c->contentTransferEncoding()->setEncoding(Headers::CEquPr);
+            c->setBody(body + " \n\n" + QByteArray(100, '='));
+            QCOMPARE(c->size(), c->encodedBody().size());
+        }
+    }
+    msg->assemble();
+    QCOMPARE(msg->storageSize(), msg->encodedContent().size());
+    QCOMPARE(msg->encodedContentSize(NewlineType::CRLF), msg->encodedContent(NewlineType::CRLF).size());
+}
+
+void MessageTest::testStructureSummary_data()
+{
+    QTest::addColumn<QString>("mailFile");
+
+    QTest::newRow("plain") << u"plain-text-body.mbox"_s;
+    QTest::newRow("multipart") << u"kmail-attachmentstatus.mbox"_s;
+    QTest::newRow("encapsulated") << u"simple-encapsulated.mbox"_s;
+    QTest::newRow("base64") << u"bug392239.mbox"_s;
+    QTest::newRow("uuencode") << u"uuencode-simple.mbox"_s;
+    QTest::newRow("encrypted") << u"x-pkcs7.mbox"_s;
+    QTest::newRow("signed") << u"dontchangemail.mbox"_s;
+    QTest::newRow("outlook") << u"outlook-attachment.mbox"_s;
+}
+
+void MessageTest::testStructureSummary()
+{
+    QFETCH(QString, mailFile);
+
+    auto msg = readAndParseMail(mailFile);
+    const MessageStructureSummary summary(msg.get());
+    QVERIFY(summary.isValid());
+    QCOMPARE(summary.flags().testFlag(MessageStructureSummary::HasAttachment), KMime::hasAttachment(msg.get()));
+    QCOMPARE(summary.flags().testFlag(MessageStructureSummary::Signed), KMime::isSigned(msg.get()));
+    QCOMPARE(summary.flags().testFlag(MessageStructureSummary::Encrypted), KMime::isEncrypted(msg.get()));
+    QCOMPARE(summary.flags().testFlag(MessageStructureSummary::HasInvitation), KMime::hasInvitation(msg.get()));
+    QCOMPARE(summary.attachmentCount(), int(msg->attachments().size()));
+    const auto textContent = msg->textContent();
+    QCOMPARE(summary.mainTextPartIndex(), textContent ? textContent->index() : ContentIndex());
+
+    int partCount = 0;
+    qint64 decodedSize = 0;
+    std::function<void(const Content *)> addParts = [&](const Content *c) {
+        if (const auto ct = c->contentType(); ct && ct->isMultipart()) {
+            for (const auto child : c->contents()) {
+                addParts(child);
+            }
+        } else {
+            ++partCount;
+            decodedSize += c->bodyIsMessage() ? c->encodedBody().size() : c->decodedBody().size();
+        }
+    };
+    addParts(msg.get());
+    QCOMPARE(summary.partCount(), partCount);
+    QCOMPARE(summary.decodedSize(), decodedSize);
+
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out << summary;
+    }
+    QDataStream in(buffer);
+    MessageStructureSummary restored;
+    QVERIFY(!restored.isValid());
+    in >> restored;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QVERIFY(restored == summary);
+
+    // data of an unknown format version
+    buffer[0] = char(0xff);
+    QDataStream corrupt(buffer);
+    corrupt >> restored;
+    QCOMPARE(corrupt.status(), QDataStream::ReadCorruptData);
+    QVERIFY(!restored.isValid());
+}
+
+void MessageTest::testStructureSummaryDecodedSize()
+{
+    KMime::Message msg;
+    msg.setContent(
+        "Content-Type: multipart/mixed; boundary=\"x\"\n"
+        "\n"
+        "--x\n"
+        "Content-Type: text/plain; charset=utf-8\n"
+        "Content-Transfer-Encoding: quoted-printable\n"
+        "\n"
+        "Gr=C3=BC=C3=9Fe, a soft=\n"
+        "ly broken line\n"
+        "--x\n"
+        "Content-Type: application/octet-stream; name=\"data.bin\"\n"
+        "Content-Transfer-Encoding: base64\n"
+        "\n"
+        "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4v\n"
+        "MDEyMzQ=\n"
+        "--x--\n");
+    msg.parse();
+
+    const MessageStructureSummary summary(&msg);
+    QCOMPARE(summary.partCount(), 2);
+    QCOMPARE(summary.attachmentCount(), 1);
+    QCOMPARE(summary.mainTextPartIndex().toString(), "1"_L1);
+    QVERIFY(summary.flags() == MessageStructureSummary::HasAttachment);
+    const auto contents = msg.contents();
+    QCOMPARE(contents[1]->decodedBody().size(), 53);
+    QCOMPARE(summary.decodedSize(), qint64(contents[0]->decodedBody().size() + 53));
+
+    // malformed encodings are sized the way the decoders handle them
+    const QList<std::pair<QByteArray, QByteArray>> bodies = {
+        {"quoted-printable", "a=\n"},
+        {"quoted-printable", "a=\r\n"},
+        {"quoted-printable", "a=3D=ZZb=\n\n"},
+        {"quoted-printable", "line=0A"},
+        {"quoted-printable", "line=0a\n"},
+        {"quoted-printable", "trailing=4"},
+        {"base64", "QUJD\nRA==\nRUZH\n"},
+        {"base64", "QUJDRA\n"},
+        {"7bit", "plain\n"},
+    };
+    for (const auto &[encoding, body] : bodies) {
+        KMime::Message part;
+        part.setContent("Content-Type: text/plain\nContent-Transfer-Encoding: " + encoding + "\n\n" + body);
+        part.parse();
+        QCOMPARE(MessageStructureSummary(&part).decodedSize(), qint64(part.decodedBody().size()));
+    }
+}
+
+void MessageTest::testStructureSummaryCrypto_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<bool>("isSigned");
+    QTest::addColumn<bool>("isEncrypted");
+
+    QTest::newRow("alternative") << QByteArray(
+        "Content-Type: multipart/alternative; boundary=\"a\"\n"
+        "\n"
+        "--a\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--a\n"
+        "Content-Type: application/pgp-encrypted\n"
+        "\n"
+        "Version: 1\n"
+        "--a--\n") << false << true;
+    QTest::newRow("first child") << QByteArray(
+        "Content-Type: multipart/mixed; boundary=\"m\"\n"
+        "\n"
+        "--m\n"
+        "Content-Type: application/pkcs7-signature\n"
+        "\n"
+        "data\n"
+        "--m\n"
+        "Content-Type: application/pgp-encrypted\n"
+        "\n"
+        "Version: 1\n"
+        "--m--\n") << true << false;
+    QTest::newRow("nested multipart") << QByteArray(
+        "Content-Type: multipart/mixed; boundary=\"m\"\n"
+        "\n"
+        "--m\n"
+        "Content-Type: multipart/signed; boundary=\"s\"\n"
+        "\n"
+        "--s\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--s\n"
+        "Content-Type: application/pgp-signature\n"
+        "\n"
+        "signature\n"
+        "--s--\n"
+        "--m--\n") << false << false;
+}
+
+void MessageTest::testStructureSummaryCrypto()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, isSigned);
+    QFETCH(bool, isEncrypted);
+
+    KMime::Message msg;
+    msg.setContent(data);
+    msg.parse();
+    QCOMPARE(KMime::isSigned(&msg), isSigned);
+    QCOMPARE(KMime::isEncrypted(&msg), isEncrypted);
+
+    const MessageStructureSummary summary(&msg);
+    QCOMPARE(summary.flags().testFlag(MessageStructureSummary::Signed), isSigned);
+    QCOMPARE(summary.flags().testFlag(MessageStructureSummary::Encrypted), isEncrypted);
+}
+
+void MessageTest::testSharedMessage()
+{
+    const QByteArray data(
+        "Subject: shared\n"
+        "Content-Type: multipart/mixed; boundary=\"x\"\n"
+        "\n"
+        "--x\n"
+        "Content-Type: text/plain; charset=utf-8\n"
+        "Content-Transfer-Encoding: base64\n"
+        "\n"
+        "R3LDvMOfZQo=\n"
+        "--x\n"
+        "Content-Type: text/plain; charset=utf-8\n"
+        "Content-Transfer-Encoding: quoted-printable\n"
+        "\n"
+        "Gr=C3=BC=C3=9Fe\n"
+        "--x--\n");
+
+    auto msg = std::make_unique<Message>();
+    msg->setContent(data);
+    msg->parse();
+    const auto encoded = msg->encodedContent();
+
+    SharedMessage shared(std::move(msg));
+    QVERIFY(!shared.isNull());
+
+    // reading from several threads leaves the shared tree untouched
+    std::vector<std::unique_ptr<QThread>> threads;
+    QList<QString> results(4);
+    for (qsizetype i = 0; i < results.size(); ++i) {
+        threads.emplace_back(QThread::create([copy = shared, &result = results[i]]() {
+            for (const auto c : copy->contents()) {
+                result += c->decodedText();
+            }
+            (void)copy->encodedContent();
+        }));
+        threads.back()->start();
+    }
+    for (const auto &thread : threads) {
+        QVERIFY(thread->wait());
+    }
+    for (const auto &result : std::as_const(results)) {
+        QCOMPARE(result, u"GrüßeGrüße"_s);
+    }
+    QCOMPARE(shared->encodedContent(), encoded);
+
+    // detaching a shared handle clones the message
+    SharedMessage copy = shared;
+    const auto original = shared.get();
+    auto modified = copy.detach();
+    QVERIFY(modified != original);
+    modified->subject()->fromUnicodeString(u"modified"_s);
+    modified->contents()[0]->setBody("modified\n");
+    QCOMPARE(shared->subject()->asUnicodeString(), u"shared"_s);
+    QCOMPARE(shared->encodedContent(), encoded);
+    QCOMPARE(copy->subject()->asUnicodeString(), u"modified"_s);
+
+    // copies of a detached handle don't see later modifications
+    {
+        const SharedMessage other = copy;
+        QVERIFY(other.get() != modified);
+        const auto snapshot = copy.message();
+        QVERIFY(snapshot.get() != modified);
+        modified->subject()->fromUnicodeString(u"modified again"_s);
+        QCOMPARE(other->subject()->asUnicodeString(), u"modified"_s);
+        QCOMPARE(snapshot->subject()->asUnicodeString(), u"modified"_s);
+        const SharedMessage otherCopy = other;
+        QCOMPARE(otherCopy.get(), other.get());
+    }
+
+    // detaching the only handle doesn't clone
+    QCOMPARE(copy.detach(), modified);
+    QVERIFY(SharedMessage().detach() == nullptr);
+}
+
 #include "moc_messagetest.cpp"
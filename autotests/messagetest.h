@@ -47,6 +47,14 @@ private Q_SLOTS:
 
     void testUuencode();
     void testYenc();
+    void testEncodedContentSize_data();
+    void testEncodedContentSize();
+    void testStructureSummary_data();
+    void testStructureSummary();
+    void testStructureSummaryDecodedSize();
+    void testStructureSummaryCrypto_data();
+    void testStructureSummaryCrypto();
+    void testSharedMessage();
 private:
     std::unique_ptr<const KMime::Message> readAndParseMail(const QString &mailFile) const;
     std::unique_ptr<KMime::Message> readAndParseMailMut(const QString &mailFile) const;
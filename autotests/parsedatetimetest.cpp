@@ -49,6 +49,24 @@ void ParseDateTimeTest::testParseDateTime_data()
     QTest::newRow("10")
         << QByteArray("Fri 24 Apr 2015 10:39:15 +in:af")
         << QDateTime();
+    QTest::newRow("lower-case names")
+        << QByteArray("fri, 24 apr 2015 10:39:15 +0200")
+        << QDateTime(QDateTime::fromString(QStringLiteral("2015-04-24T10:39:15+02:00"), Qt::ISODate));
+    QTest::newRow("leap day")
+        << QByteArray("Mon, 29 Feb 2016 23:59:59 -0130")
+        << QDateTime(QDateTime::fromString(QStringLiteral("2016-02-29T23:59:59-01:30"), Qt::ISODate));
+    QTest::newRow("before epoch")
+        << QByteArray("Thu, 13 Feb 1969 23:32:00 -0330")
+        << QDateTime(QDateTime::fromString(QStringLiteral("1969-02-13T23:32:00-03:30"), Qt::ISODate));
+    QTest::newRow("no leap day")
+        << QByteArray("Sun, 29 Feb 2015 10:39:15 +0200")
+        << QDateTime();
+    QTest::newRow("invalid day")
+        << QByteArray("Thu, 31 Apr 2015 10:39:15 +0200")
+        << QDateTime();
+    QTest::newRow("invalid time")
+        << QByteArray("Fri, 24 Apr 2015 24:39:15 +0200")
+        << QDateTime();
 }
 
 void ParseDateTimeTest::testParseDateTime()
@@ -59,6 +77,11 @@ void ParseDateTimeTest::testParseDateTime()
     KMime::Headers::Date hdr;
     hdr.from7BitString(input);
     QCOMPARE(hdr.dateTime(), expResult);
+    QCOMPARE(hdr.isEmpty(), !expResult.isValid());
+    if (expResult.isValid()) {
+        QCOMPARE(hdr.secsSinceEpoch(), expResult.toSecsSinceEpoch());
+        QCOMPARE(hdr.offsetFromUtc(), expResult.offsetFromUtc());
+    }
 }
 
 
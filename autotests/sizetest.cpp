@@ -29,7 +29,7 @@ private Q_SLOTS:
         QVERIFY(sizeof(Content) <= 16);
         qDebug() << sizeof(ContentPrivate);
         QVERIFY(sizeof(ContentPrivate) <=
-                (sizeof(QByteArray) * 5 + sizeof(QList<Content *>) * 2 + 32));
+                (sizeof(QByteArray) * 6 + sizeof(QList<Content *>) * 2 + 32));
         qDebug() << sizeof(Message);
         QCOMPARE(sizeof(Message), sizeof(Content));
     }
@@ -74,12 +74,12 @@ private Q_SLOTS:
                    sizeof(BasePrivate) + sizeof(QList<Types::Mailbox>));
         VERIFYSIZE(SingleMailboxPrivate, sizeof(StructuredPrivate) + sizeof(Types::Mailbox));
         VERIFYSIZE(AddressListPrivate, sizeof(BasePrivate) + sizeof(QList<KMime::Types::Address>));
-        VERIFYSIZE(IdentPrivate, sizeof(AddressListPrivate) + sizeof(QList<KMime::Types::AddrSpec>));
-        VERIFYSIZE(SingleIdentPrivate, sizeof(StructuredPrivate) + sizeof(KMime::Types::AddrSpec) + sizeof(QByteArray));
+        VERIFYSIZE(IdentPrivate, sizeof(StructuredPrivate) + sizeof(QByteArray) + sizeof(QList<qsizetype>));
+        VERIFYSIZE(SingleIdentPrivate, sizeof(StructuredPrivate) + sizeof(QByteArray));
         VERIFYSIZE(TokenPrivate, sizeof(StructuredPrivate) + sizeof(QByteArray));
         VERIFYSIZE(PhraseListPrivate, sizeof(StructuredPrivate) + sizeof(QStringList));
         VERIFYSIZE(DotAtomPrivate, sizeof(StructuredPrivate) + sizeof(QByteArray));
-        VERIFYSIZE(ParametrizedPrivate, sizeof(StructuredPrivate) + sizeof(std::map<QByteArray, QString>));
+        VERIFYSIZE(ParametrizedPrivate, sizeof(StructuredPrivate) + sizeof(QVarLengthArray<std::pair<QByteArray, QByteArray>, 2>));
         VERIFYSIZE(ReturnPathPrivate, sizeof(StructuredPrivate) + sizeof(Types::Mailbox));
         VERIFYSIZE(MailCopiesToPrivate, sizeof(AddressListPrivate) + 8);
         VERIFYSIZE(ContentTransferEncodingPrivate, sizeof(TokenPrivate) + 8);
@@ -87,7 +87,7 @@ private Q_SLOTS:
         VERIFYSIZE(ContentTypePrivate, sizeof(ParametrizedPrivate) + sizeof(QByteArray) + 8);
         VERIFYSIZE(GenericPrivate, sizeof(UnstructuredPrivate) + 8);
         VERIFYSIZE(ControlPrivate, sizeof(StructuredPrivate) + 2*sizeof(QByteArray));
-        VERIFYSIZE(DatePrivate, sizeof(StructuredPrivate) + 8);
+        VERIFYSIZE(DatePrivate, sizeof(StructuredPrivate) + sizeof(QDateTime) + 16);
         VERIFYSIZE(NewsgroupsPrivate,
                    sizeof(StructuredPrivate) + sizeof(QList<QByteArray>));
         VERIFYSIZE(LinesPrivate, sizeof(StructuredPrivate) + 8);
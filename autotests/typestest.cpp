@@ -68,6 +68,43 @@ private Q_SLOTS:
         // ... although the display name can also be UTF8... maybe later.
     }
 
+    void testMailboxSetters()
+    {
+        Types::Mailbox mbox;
+        QVERIFY(!mbox.hasName());
+        QVERIFY(!mbox.hasAddress());
+        QCOMPARE(mbox.address(), QByteArray());
+
+        mbox.setAddress(Types::AddrSpec{u"john.doe"_s, u"example.org"_s});
+        QVERIFY(mbox.hasAddress());
+        QCOMPARE(mbox.address(), QByteArray("john.doe@example.org"));
+
+        mbox.setName(u"Jöhn Doe"_s);
+        QCOMPARE(mbox.name(), u"Jöhn Doe"_s);
+        QCOMPARE(mbox.address(), QByteArray("john.doe@example.org"));
+        QCOMPARE(mbox.addrSpec().localPart, u"john.doe"_s);
+        QCOMPARE(mbox.addrSpec().domain, u"example.org"_s);
+
+        mbox.setAddress(Types::AddrSpec{u"john \"doe\""_s, u"example.org"_s});
+        QCOMPARE(mbox.name(), u"Jöhn Doe"_s);
+        QCOMPARE(mbox.address(), QByteArray("\"john \\\"doe\\\"\"@example.org"));
+        QCOMPARE(mbox.addrSpec().localPart, u"john \"doe\""_s);
+
+        mbox.setName(QString());
+        QVERIFY(!mbox.hasName());
+        QCOMPARE(mbox.address(), QByteArray("\"john \\\"doe\\\"\"@example.org"));
+
+        mbox.from7BitString("\"Doe, John\" <john@example.org>");
+        QCOMPARE(mbox.name(), u"Doe, John"_s);
+        QCOMPARE(mbox.address(), QByteArray("john@example.org"));
+        mbox.from7BitString("< john @ example.org >");
+        QVERIFY(!mbox.hasName());
+        QCOMPARE(mbox.address(), QByteArray("john@example.org"));
+        mbox.from7BitString("john@example.org. (John)");
+        QCOMPARE(mbox.name(), u"John"_s);
+        QCOMPARE(mbox.address(), QByteArray("john@example.org."));
+    }
+
     void testListToString()
     {
         QList<Types::Mailbox> mboxes;
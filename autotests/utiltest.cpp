@@ -12,6 +12,8 @@
 #include <util_p.cpp>
 #include "message.h"
 
+#include <KCodecs>
+
 using namespace KMime;
 
 QTEST_MAIN(UtilTest)
@@ -116,6 +118,18 @@ void UtilTest::testFoldHeader()
     // honor already inserted folding: fold at correct position
     QCOMPARE(KMime::foldHeader("To: some@where,\n some@else, fooooooooooooooooooooooooooooooooooooooooooooooooooooooooo@baaaaaar"),
                     QByteArray("To: some@where,\n some@else,\n fooooooooooooooooooooooooooooooooooooooooooooooooooooooooo@baaaaaar"));
+
+    // long header with many folding points round-trips through unfolding
+    QByteArray references("References:");
+    for (int i = 0; i < 50; ++i) {
+        references += " <message" + QByteArray::number(i) + "@some.where.example.org>";
+    }
+    const QByteArray folded = KMime::foldHeader(references);
+    QVERIFY(folded.count('\n') > 10);
+    for (const auto &line : folded.split('\n')) {
+        QVERIFY(line.size() <= 78);
+    }
+    QCOMPARE(KMime::unfoldHeader(folded), references);
 }
 
 void UtilTest::testExtractHeader()
@@ -145,6 +159,156 @@ void UtilTest::testExtractHeader()
 
     // missing space after ':'
     QCOMPARE(extractHeader("From:<toma@kovoks.nl>", "From"), QByteArray("<toma@kovoks.nl>"));
+
+    // embedded NUL bytes don't end the search
+    const QByteArray nul = QByteArray("X-Foo: a", 8) + QByteArray(1, '\0') + "b\nTo: <foo@bla.org>\n";
+    QCOMPARE(extractHeader(nul, "To"), QByteArray("<foo@bla.org>"));
+
+    // only field names match, not values
+    QVERIFY(extractHeader("X-Foo: bar\nTo: <foo@bla.org>\n", "bar").isNull());
+
+    // lines without a colon don't hide the field after them
+    QCOMPARE(extractHeader("X-Foo: bar\ngarbage line\nTo: <foo@bla.org>\n", "To"), QByteArray("<foo@bla.org>"));
+    QCOMPARE(extractHeader("garbage\nTo: <foo@bla.org>\n", "To"), QByteArray("<foo@bla.org>"));
+}
+
+void UtilTest::testNextHeaderField()
+{
+    const QByteArrayView head("garbage\nX-Foo: bar\n baz\nanother garbage line\nTo: <foo@bla.org>\n");
+    qsizetype cursor = 0;
+    HeaderField field;
+    QVERIFY(nextHeaderField(head, cursor, field));
+    QCOMPARE(field.name.toByteArray(), QByteArray("X-Foo"));
+    QCOMPARE(field.body.toByteArray(), QByteArray("bar\n baz"));
+    QVERIFY(field.folded);
+    QVERIFY(nextHeaderField(head, cursor, field));
+    QCOMPARE(field.name.toByteArray(), QByteArray("To"));
+    QCOMPARE(field.body.toByteArray(), QByteArray("<foo@bla.org>"));
+    QVERIFY(!field.folded);
+    QVERIFY(!nextHeaderField(head, cursor, field));
+
+    // header parsing uses the same tokenizer
+    KMime::Message msg;
+    msg.setHead(head.toByteArray());
+    msg.parseHeaders();
+    QVERIFY(msg.headerByType("X-Foo"));
+    QVERIFY(msg.to(KMime::DontCreate));
+    QCOMPARE(msg.to()->addresses(), QList<QByteArray>{"foo@bla.org"});
+}
+
+void UtilTest::testRawHeaderIndex()
+{
+    const QByteArray header("To: <foo@bla.org>\n"
+                            "Subject: first\n"
+                            " line\n"
+                            "Received: one\n"
+                            "subject: second\n"
+                            "Received: two\n"
+                            "X-Empty:\n"
+                            "MIME-Version: 1.0");
+    const RawHeaderIndex index(header);
+
+    QVERIFY(index.contains("to"));
+    QVERIFY(!index.contains("Foo"));
+    QVERIFY(index.value("Foo").isNull());
+    QCOMPARE(index.value("To"), QByteArray("<foo@bla.org>"));
+    QCOMPARE(index.value("mime-version"), QByteArray("1.0"));
+
+    // the first occurrence wins, as with extractHeader()
+    QCOMPARE(index.value("SUBJECT"), QByteArray("first line"));
+    QCOMPARE(index.value("Received"), QByteArray("one"));
+
+    QVERIFY(index.contains("X-Empty"));
+    QVERIFY(!index.value("X-Empty").isNull());
+    QVERIFY(index.value("X-Empty").isEmpty());
+
+    for (const auto name : {"To", "Subject", "Received", "X-Empty", "MIME-Version", "Foo"}) {
+        QCOMPARE(index.value(name), extractHeader(header, name));
+    }
+
+    // enough fields to fill several slots of the table
+    QByteArray many;
+    for (int i = 0; i < 100; ++i) {
+        many += "X-Field-" + QByteArray::number(i) + ": " + QByteArray::number(i) + '\n';
+    }
+    const RawHeaderIndex manyIndex(many);
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(manyIndex.value("x-field-" + QByteArray::number(i)), QByteArray::number(i));
+    }
+    QVERIFY(!manyIndex.contains("X-Field-100"));
+}
+
+void UtilTest::testEncodedSize_data()
+{
+    QTest::addColumn<QByteArray>("input");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("short") << QByteArray("foo");
+    QTest::newRow("one line") << QByteArray(57, 'x');
+    QTest::newRow("one line plus one") << QByteArray(58, 'x');
+    QTest::newRow("long") << QByteArray(1000, 'x');
+    QTest::newRow("lines") << QByteArray("foo\nbar\n\nbaz\n");
+    QTest::newRow("trailing spaces") << QByteArray("foo \nbar  \n \n ");
+    QTest::newRow("crlf") << QByteArray("foo\r\nbar\r\n");
+    QTest::newRow("special") << QByteArray("a=b\tc\x01\xff\xe4");
+    QTest::newRow("long line") << QByteArray("0123456789 ").repeated(20);
+    QTest::newRow("long encoded line") << QByteArray("\xe4\xf6\xfc=").repeated(30);
+    QByteArray binary;
+    for (int i = 0; i < 1024; ++i) {
+        binary.append(char(i * 7 % 256));
+    }
+    QTest::newRow("binary") << binary;
+}
+
+void UtilTest::testEncodedSize()
+{
+    QFETCH(QByteArray, input);
+
+    QByteArray encoded;
+    qsizetype lineBreaks = -1;
+    KCodecs::base64Encode(input, encoded, true);
+    QCOMPARE(base64EncodedSize(input.size(), &lineBreaks), encoded.size());
+    QCOMPARE(lineBreaks, encoded.count('\n'));
+
+    encoded = KCodecs::quotedPrintableEncode(input, false);
+    QCOMPARE(quotedPrintableEncodedSize(input, &lineBreaks), encoded.size());
+    QCOMPARE(lineBreaks, encoded.count('\n'));
+}
+
+void UtilTest::testQuotedPrintableDecodeInPlace_data()
+{
+    QTest::addColumn<QByteArray>("input");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("plain") << QByteArray("foo bar\n");
+    QTest::newRow("escapes") << QByteArray("f=C3=B6=c3=b6 =3D\n");
+    QTest::newRow("soft line breaks") << QByteArray("foo=\nbar=\r\nbaz");
+    QTest::newRow("invalid escape") << QByteArray("foo=XYbar=4");
+    QTest::newRow("trailing escape") << QByteArray("foo=");
+    QTest::newRow("trailing soft line break") << QByteArray("foo=\n");
+}
+
+void UtilTest::testQuotedPrintableDecodeInPlace()
+{
+    QFETCH(QByteArray, input);
+
+    const QByteArray expected = KCodecs::quotedPrintableDecode(input);
+
+    // shared input must not be modified
+    const QByteArray original(input.constData(), input.size());
+    QByteArray shared = input;
+    quotedPrintableDecodeInPlace(shared);
+    QCOMPARE(shared, expected);
+    QCOMPARE(input, original);
+
+    // unshared input is decoded without reallocation
+    QByteArray unshared(input.constData(), input.size());
+    const auto data = unshared.constData();
+    quotedPrintableDecodeInPlace(unshared);
+    QCOMPARE(unshared, expected);
+    if (!input.isEmpty()) {
+        QCOMPARE(unshared.constData(), data);
+    }
 }
 
 void UtilTest::testBalanceBidiState()
@@ -15,6 +15,12 @@ private Q_SLOTS:
     void testUnfoldHeader();
     void testFoldHeader();
     void testExtractHeader();
+    void testNextHeaderField();
+    void testRawHeaderIndex();
+    void testEncodedSize_data();
+    void testEncodedSize();
+    void testQuotedPrintableDecodeInPlace_data();
+    void testQuotedPrintableDecodeInPlace();
     void testBalanceBidiState();
     void testBalanceBidiState_data();
     void testAddQuotes();
@@ -13,10 +13,99 @@
 
 #include <KCodecs>
 
+#include <QHash>
+#include <QReadWriteLock>
 #include <QStringEncoder>
 
+#include <map>
+#include <optional>
+
 namespace KMime {
 
+// maximum number of charsets remembered per cache, so that bogus input
+// can't grow them indefinitely
+constexpr inline const qsizetype CHARSET_CACHE_LIMIT = 128;
+
+namespace {
+struct CharsetInfo {
+    // set if this is a charset QStringConverter supports natively
+    std::optional<QStringConverter::Encoding> encoding;
+    bool valid = false;
+};
+}
+
+static CharsetInfo charsetInfo(const QByteArray &charset)
+{
+    static QReadWriteLock lock;
+    static QHash<QByteArray, CharsetInfo> cache;
+
+    {
+        QReadLocker locker(&lock);
+        if (const auto it = cache.constFind(charset); it != cache.constEnd()) {
+            return it.value();
+        }
+    }
+
+    CharsetInfo info;
+    info.encoding = QStringConverter::encodingForName(charset);
+    // anything else needs to be looked up (and possibly loaded) by name
+    info.valid = info.encoding || QStringDecoder(charset.constData()).isValid();
+
+    QWriteLocker locker(&lock);
+    if (cache.size() < CHARSET_CACHE_LIMIT) {
+        cache.insert(charset, info);
+    }
+    return info;
+}
+
+template <typename T>
+static T makeConverter(const QByteArray &charset)
+{
+    const auto info = charsetInfo(charset);
+    if (info.encoding) {
+        return T(*info.encoding);
+    }
+    if (info.valid) {
+        return T(charset.constData());
+    }
+    return T();
+}
+
+template <typename T>
+static T &cachedConverter(const QByteArray &charset)
+{
+    // std::map doesn't move its elements, so references to them stay valid
+    thread_local std::map<QByteArray, T> converters;
+    thread_local T uncached;
+
+    if (const auto it = converters.find(charset); it != converters.end()) {
+        it->second.resetState();
+        return it->second;
+    }
+
+    auto converter = makeConverter<T>(charset);
+    if (!converter.isValid() || qsizetype(converters.size()) >= CHARSET_CACHE_LIMIT) {
+        uncached = std::move(converter);
+        return uncached;
+    }
+    return converters.emplace(charset, std::move(converter)).first->second;
+}
+
+QStringDecoder &cachedDecoder(const QByteArray &charset)
+{
+    return cachedConverter<QStringDecoder>(charset);
+}
+
+QStringEncoder &cachedEncoder(const QByteArray &charset)
+{
+    return cachedConverter<QStringEncoder>(charset);
+}
+
+QStringDecoder makeDecoder(const QByteArray &charset)
+{
+    return makeConverter<QStringDecoder>(charset);
+}
+
 static const char reservedCharacters[] = "\"()<>@,.;:\\[]=";
 
 QByteArray encodeRFC2047Sentence(QStringView src, const QByteArray &charset)
@@ -65,7 +154,7 @@ QByteArray encodeRFC2231String(QStringView str, const QByteArray &charset)
       return {};
     }
 
-    QStringEncoder codec(charset.constData());
+    auto &codec = cachedEncoder(charset);
     QByteArray latin;
     if (charset == "us-ascii") {
         latin = str.toLatin1();
@@ -11,6 +11,8 @@
 
 #include <QByteArray>
 #include <QString>
+#include <QStringDecoder>
+#include <QStringEncoder>
 
 namespace KMime
 {
@@ -32,5 +34,36 @@ namespace KMime
 [[nodiscard]] QByteArray encodeRFC2231String(QStringView src,
                                              const QByteArray &charset);
 
+/**
+  Returns a decoder for @p charset, or an invalid decoder if @p charset
+  is not supported.
+
+  Decoders are created only once per thread and charset, and are reset to
+  their initial state before being returned. The returned reference is only
+  valid until the next call of this function on the same thread.
+
+  @param charset the name of the charset.
+*/
+[[nodiscard]] QStringDecoder &cachedDecoder(const QByteArray &charset);
+
+/**
+  Returns an encoder for @p charset, or an invalid encoder if @p charset
+  is not supported.
+
+  The same caching rules as for cachedDecoder() apply.
+
+  @param charset the name of the charset.
+*/
+[[nodiscard]] QStringEncoder &cachedEncoder(const QByteArray &charset);
+
+/**
+  Creates a new decoder for @p charset, for use cases where the decoder
+  is needed beyond the lifetime guarantees of cachedDecoder(). This still
+  avoids looking up the charset again.
+
+  @param charset the name of the charset.
+*/
+[[nodiscard]] QStringDecoder makeDecoder(const QByteArray &charset);
+
 } // namespace KMime
 
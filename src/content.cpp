@@ -20,6 +20,8 @@
 */
 #include "content.h"
 #include "content_p.h"
+#include "codecs_p.h"
+#include "decodedcontentcache_p.h"
 #include "kmime_debug.h"
 #include "message.h"
 #include "headerfactory_p.h"
@@ -30,9 +32,16 @@
 
 #include <KCodecs>
 
+#include <QMutex>
 #include <QStringDecoder>
 #include <QStringEncoder>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iterator>
+#include <utility>
+
 using namespace KMime;
 
 namespace KMime
@@ -40,6 +49,26 @@ namespace KMime
 
 constexpr inline const auto PARSING_DEPTH_LIMIT = 32;
 
+// upper limit for the memory used by all cached encoded bodies together
+constexpr inline const qsizetype ENCODED_BODY_CACHE_BUDGET = 64 * 1024 * 1024;
+static std::atomic<qsizetype> s_encodedBodyCacheSize = 0;
+
+// The encoded body cache is filled by const methods, which may be called from several
+// threads at the same time. A few locks shared by all Contents are enough to protect it.
+static QMutex &encodedBodyCacheLock(const ContentPrivate *d)
+{
+    static QMutex locks[16];
+    return locks[reinterpret_cast<quintptr>(d) / alignof(ContentPrivate) % std::size(locks)];
+}
+
+// whether q is a text content that decodeText() can decode
+static bool isDecodableText(const Content *q)
+{
+    // content of type text/pgp might be a binary blob of encrypted text; it must not be decoded as text
+    const auto ct = q->contentType();
+    return !ct || (ct->isText() && !ct->isSubtype("pgp"));
+}
+
 Content::Content()
     : d_ptr(new ContentPrivate)
 {
@@ -49,7 +78,10 @@ Content::~Content()
 {
     // remove us from the parent node, when deleting a sub-node explicitly
     if (d_ptr->parent) {
-        d_ptr->parent->d_ptr->multipartContents.removeAll(this);
+        auto parent = d_ptr->parent->d_ptr.get();
+        if (parent->multipartContents.removeAll(this) > 0) {
+            parent->updateChildIndexes(std::max(d_ptr->indexInParent, 0));
+        }
     }
 
     qDeleteAll(d_ptr->headers);
@@ -58,12 +90,13 @@ Content::~Content()
 
 bool Content::hasContent() const
 {
-    return !d_ptr->head.isEmpty() || !d_ptr->body.isEmpty() || !d_ptr->contents().isEmpty();
+    return !d_ptr->head.isEmpty() || !d_ptr->body.isEmpty() || !d_ptr->children().isEmpty();
 }
 
 void Content::setContent(const QByteArray &s)
 {
     Q_D(Content);
+    d->invalidateBodyCaches();
     KMime::HeaderParsing::extractHeaderAndBody(s, d->head, d->body);
 }
 
@@ -87,12 +120,14 @@ QByteArray Content::body() const
 
 void Content::setBody(const QByteArray &body)
 {
+    d_ptr->invalidateBodyCaches();
     d_ptr->body = body;
     d_ptr->m_decoded = true;
 }
 
 void Content::setEncodedBody(const QByteArray &body)
 {
+    d_ptr->invalidateBodyCaches();
     d_ptr->body = body;
     d_ptr->m_decoded = false;
 }
@@ -120,14 +155,10 @@ void Content::setEpilogue(const QByteArray &epilogue)
 void Content::parse()
 {
     Q_D(Content);
+    d->invalidateBodyCaches();
 
     // Clean up old headers and parse them again.
-    qDeleteAll(d->headers);
-    d->headers.clear();
-    d->headers = HeaderParsing::parseHeaders(d->head);
-    if (const auto cte = contentTransferEncoding(DontCreate); cte) {
-        d->m_decoded = (cte->encoding() == Headers::CE7Bit || cte->encoding() == Headers::CE8Bit);
-    }
+    qDeleteAll(d->replaceHeaders(this));
 
     // If we are frozen, save the body as-is. This is done because parsing
     // changes the content (it loses preambles and epilogues, converts uuencode->mime, etc.)
@@ -138,10 +169,6 @@ void Content::parse()
     // Clean up old sub-Contents and parse them again.
     d->clearContents();
     Headers::ContentType *ct = contentType();
-    if (ct->isEmpty()) { //Set default content-type as defined in https://tools.ietf.org/html/rfc2045#page-10 (5.2.  Content-Type Defaults)
-        ct->setMimeType("text/plain");
-        ct->setCharset("us-ascii");
-    }
     if (ct->isText()) {
         // This content is either text, or of unknown type.
 
@@ -178,11 +205,39 @@ void Content::parse()
             d->body.clear();
 
             d->bodyAsMessage->d_ptr->parent = this; // set parent before the recursion, so the depth limit works
+            d->bodyAsMessage->d_ptr->indexInParent = 0;
             d->bodyAsMessage->parse();
         }
     }
 }
 
+void Content::parseHeaders()
+{
+    Q_D(Content);
+    d->invalidateBodyCaches();
+
+    auto oldHeaders = d->replaceHeaders(this);
+
+    // The sub-Contents and the encapsulated message stay valid as long as the
+    // new headers still describe the same kind of body.
+    const Headers::ContentType *ct = contentType();
+    const bool isMultipart = ct->isMultipart();
+    const bool isMessage = ct->isMimeType("message/rfc822") && d->depth() < PARSING_DEPTH_LIMIT;
+    if (isMultipart == !d->multipartContents.isEmpty() && isMessage == (d->bodyAsMessage != nullptr)) {
+        qDeleteAll(oldHeaders);
+        return;
+    }
+
+    // Otherwise split up the body again, as assembled by the old headers.
+    if (!d->multipartContents.isEmpty() || d->bodyAsMessage) {
+        d->headers.swap(oldHeaders);
+        d->body = encodedBody();
+        d->headers.swap(oldHeaders);
+    }
+    qDeleteAll(oldHeaders);
+    parse();
+}
+
 bool Content::isFrozen() const
 {
     return d_ptr->frozen;
@@ -207,8 +262,7 @@ void Content::assemble()
         }
     }
 
-    const auto contentsList = contents();
-    for (Content *c : contentsList) {
+    for (Content *c : d->children()) {
         c->assemble();
     }
 }
@@ -221,6 +275,7 @@ void Content::clear()
     d->clearContents();
     d->head.clear();
     d->body.clear();
+    d->invalidateBodyCaches();
 }
 
 void ContentPrivate::clearContents()
@@ -287,14 +342,7 @@ QByteArray Content::encodedBody() const
         const auto enc = contentTransferEncoding();
 
         if (enc && d->needToEncode(this)) {
-            if (enc->encoding() == Headers::CEquPr) {
-                e += KCodecs::quotedPrintableEncode(d->body, false);
-            } else {
-                QByteArray encoded;
-                KCodecs::base64Encode(d->body, encoded, true);
-                e += encoded;
-                e += '\n';
-            }
+            e += d->encodeBody(enc->encoding());
         } else {
             e += d->body;
         }
@@ -334,6 +382,13 @@ QByteArray Content::decodedBody() const
         return ret;
     }
 
+    // only results that actually needed decoding are worth caching
+    const bool cacheable = ec && !d_ptr->m_decoded
+        && (ec->encoding() == Headers::CEbase64 || ec->encoding() == Headers::CEquPr || ec->encoding() == Headers::CEuuenc);
+    if (cacheable && DecodedContentCachePrivate::findBody(d_ptr.get(), ec->encoding(), ret)) {
+        return ret;
+    }
+
     if (!ec || d_ptr->m_decoded) {
         ret = d_ptr->body;
         //Laurent Fix bug #311267
@@ -372,25 +427,35 @@ QByteArray Content::decodedBody() const
         ret.resize(ret.size() - 1);
     }
 
+    if (cacheable) {
+        DecodedContentCachePrivate::insertBody(d_ptr.get(), ec->encoding(), ret);
+    }
     return ret;
 }
 
 QString Content::decodedText(DecodedTextTrimOption trimOption) const
 {
-    if (!d_ptr->decodeText(this)) {   //this is not a text content !!
+    if (!isDecodableText(this)) {   //this is not a text content !!
       return {};
     }
 
-    QStringDecoder codec;
-    if (const auto ct = contentType(); ct) {
-        codec = QStringDecoder(ct->charset().constData());
-    }
-    if (!codec.isValid()) {   // no suitable codec found => try local settings and hope for the best ;-)
-        codec = QStringDecoder(QStringDecoder::System);
+    QString s;
+    const auto ct = contentType();
+    const auto charset = ct ? ct->charset() : QByteArray();
+    const auto cte = contentTransferEncoding();
+    // the tag of an unencoded body doesn't matter, as long as it is distinct
+    const auto encoding = static_cast<quint8>(cte && !d_ptr->m_decoded ? cte->encoding() : 0xff);
+    if (!DecodedContentCachePrivate::findText(d_ptr.get(), encoding, charset, s)) {
+        QByteArray text;
+        (void)d_ptr->decodedTextBody(this, text);
+        if (auto &codec = cachedDecoder(charset); codec.isValid()) {
+            s = codec.decode(text);
+        } else {   // no suitable codec found => try local settings and hope for the best ;-)
+            s = QStringDecoder(QStringDecoder::System).decode(text);
+        }
+        DecodedContentCachePrivate::insertText(d_ptr.get(), encoding, charset, s);
     }
 
-    QString s = codec.decode(d_ptr->body);
-
     if (trimOption != NoTrim) {
         qsizetype i;
         for (i = s.length() - 1; i >= 0; --i) {
@@ -414,17 +479,154 @@ QString Content::decodedText(DecodedTextTrimOption trimOption) const
     return s;
 }
 
-void Content::fromUnicodeString(const QString &s)
+bool Content::decodedTextChunks(const std::function<void(QStringView)> &callback, DecodedTextTrimOption trimOption) const
 {
-    QStringEncoder codec(contentType()->charset().constData());
+    if (!isDecodableText(this)) {   //this is not a text Content !!
+        return false;
+    }
+
+    // maximum number of input bytes decoded at once
+    constexpr qsizetype chunkSize = 64 * 1024;
+
+    // The transfer encoding is removed chunk by chunk as well, so the decoded
+    // body is never held in memory as a whole. uuencoded bodies can't be
+    // decoded in chunks, they are decoded up front instead.
+    QByteArrayView input = d_ptr->body;
+    QByteArray uudecoded;
+    std::unique_ptr<KCodecs::Decoder> base64Decoder;
+    bool quotedPrintable = false;
+    if (const auto cte = contentTransferEncoding(); cte && !d_ptr->m_decoded) {
+        switch (cte->encoding()) {
+        case Headers::CEbase64:
+            base64Decoder.reset(KCodecs::Codec::codecForName("base64")->makeDecoder());
+            break;
+        case Headers::CEquPr:
+            // decoded like decodedText() does, see below
+            quotedPrintable = true;
+            break;
+        case Headers::CEuuenc:
+            (void)d_ptr->decodedTextBody(this, uudecoded);
+            input = uudecoded;
+            break;
+        default:
+            break;
+        }
+    }
 
-    if (!codec.isValid()) {   // no suitable codec found => try local settings and hope for the best ;-)
-        codec = QStringEncoder(QStringEncoder::System);
-        QByteArray chset = codec.name();
-        contentType()->setCharset(chset);
+    QStringDecoder codec = ContentPrivate::textDecoder(this);
+    const auto isTrimmable = [trimOption](QChar c) {
+        return trimOption == TrimSpaces ? c.isSpace() : c == QLatin1Char('\n');
+    };
+
+    // trailing characters of the text so far that might be trimmed
+    QString pending;
+    const auto processText = [&](QStringView text) {
+        auto keep = text.size();
+        if (trimOption == NoTrim) {
+            // only a single trailing new-line is removed
+            if (text.endsWith(QLatin1Char('\n'))) {
+                --keep;
+            }
+        } else {
+            while (keep > 0 && isTrimmable(text[keep - 1])) {
+                --keep;
+            }
+        }
+
+        if (keep == 0) {
+            pending += text;
+            return;
+        }
+        if (!pending.isEmpty()) {
+            callback(pending);
+            pending.clear();
+        }
+        callback(text.first(keep));
+        pending += text.sliced(keep);
+    };
+
+    QString buffer;
+    bool endsWithNewline = false;
+    const auto processBytes = [&](QByteArrayView bytes) {
+        if (bytes.isEmpty()) {
+            return;
+        }
+        endsWithNewline = bytes.endsWith('\n');
+        const auto requiredSpace = codec.requiredSpace(bytes.size());
+        if (buffer.size() < requiredSpace) {
+            buffer.resize(requiredSpace);
+        }
+        processText(QStringView(buffer.constData(), codec.appendToBuffer(buffer.data(), bytes)));
+    };
+
+    QByteArray decoded(base64Decoder ? chunkSize : 0, Qt::Uninitialized);
+    // start of a quoted-printable escape sequence cut off at the end of the previous chunk
+    QByteArray escapeStart;
+    for (qsizetype pos = 0; pos < input.size(); pos += chunkSize) {
+        const auto chunk = input.sliced(pos, std::min(chunkSize, input.size() - pos));
+        if (base64Decoder) {
+            // continue as long as the output buffer filled up before the chunk was
+            // consumed, the decoder stops on its own after the padding
+            const char *in = chunk.begin();
+            const auto decodedEnd = decoded.constData() + decoded.size();
+            char *out;
+            do {
+                out = decoded.data();
+                base64Decoder->decode(in, chunk.end(), out, decodedEnd);
+                processBytes(QByteArrayView(decoded.constData(), out));
+            } while (in != chunk.end() && out == decodedEnd);
+        } else if (quotedPrintable) {
+            // quotedPrintableDecodeInPlace() looks at the two characters after a '=',
+            // so a '=' among the last two characters is kept for the next chunk
+            decoded.resize(0);
+            decoded += escapeStart;
+            decoded += chunk;
+            escapeStart.resize(0);
+            if (pos + chunk.size() < input.size()) {
+                const auto size = decoded.size();
+                const auto keep = size >= 2 && decoded[size - 2] == '=' ? size - 2 : decoded.endsWith('=') ? size - 1 : size;
+                escapeStart = decoded.sliced(keep);
+                decoded.truncate(keep);
+            }
+            quotedPrintableDecodeInPlace(decoded);
+            processBytes(decoded);
+        } else {
+            processBytes(chunk);
+        }
     }
+    if (base64Decoder) {
+        for (bool done = false; !done;) {
+            char *out = decoded.data();
+            done = base64Decoder->finish(out, decoded.constData() + decoded.size());
+            processBytes(QByteArrayView(decoded.constData(), out));
+        }
+    }
+
+    // same as decodedText(), which terminates the decoded text by a new-line,
+    // this also turns a multi-byte sequence cut off at the end of the text
+    // into a replacement character
+    if (!endsWithNewline) {
+        processBytes("\n");
+    }
+
+    if (trimOption == NoTrim && pending.size() > 1) {
+        // everything but the last new-line is kept
+        pending.chop(1);
+        callback(pending);
+    }
+    return true;
+}
 
-    d_ptr->body = codec.encode(s);
+void Content::fromUnicodeString(const QString &s)
+{
+    d_ptr->invalidateBodyCaches();
+    if (auto &codec = cachedEncoder(contentType()->charset()); codec.isValid()) {
+        d_ptr->body = codec.encode(s);
+    } else {   // no suitable codec found => try local settings and hope for the best ;-)
+        QStringEncoder systemCodec(QStringEncoder::System);
+        contentType()->setCharset(systemCodec.name());
+        d_ptr->body = systemCodec.encode(s);
+    }
     d_ptr->m_decoded = true;   //text is always decoded
 }
 
@@ -438,36 +640,26 @@ const Content *Content::textContent() const
 {
     //return the first content with mimetype=text/*
     // see ContentType::isText, that's also true for an empty header
-    if (const auto ct = contentType(); !ct || ct->isText()) {
-        return this;
-    }
-
-    const auto contents = d_ptr->contents();
-    for (const Content *c : contents) {
-        if (auto ret = c->textContent()) {
-            return ret;
+    const Content *result = nullptr;
+    ContentPrivate::walk(this, [&result](const Content *c) {
+        if (const auto ct = c->contentType(); !ct || ct->isText()) {
+            result = c;
+            return WalkResult::Stop;
         }
-    }
-
-    return nullptr;
+        return WalkResult::Continue;
+    });
+    return result;
 }
 
 QList<Content *> Content::attachments() {
     QList<Content *> result;
 
-    auto ct = contentType();
-    if (ct && ct->isMultipart() &&
-        !ct->isSubtype("related") /* && !ct->isSubtype("alternative")*/) {
-        const auto contentsList = contents();
-        result.reserve(contentsList.size());
-        for (auto child : contentsList) {
-            if (isAttachment(child)) {
-                result.push_back(child);
-            } else {
-                result += child->attachments();
-            }
-      }
-    }
+    classifyParts(this, PartRole::Attachment, [this, &result](const Content *c, PartRoles roles) {
+        if (c != this && roles.testFlag(PartRole::Attachment)) {
+            result.push_back(const_cast<Content *>(c));
+        }
+        return true;
+    });
 
     return result;
 }
@@ -490,6 +682,7 @@ void Content::appendContent(std::unique_ptr<KMime::Content> &&content)
         // If the content was part of something else, this will remove it from there.
         c->setParent(this);
     }
+    c->d_ptr->indexInParent = d->multipartContents.size() - 1;
 }
 
 void Content::prependContent(std::unique_ptr<KMime::Content> &&content)
@@ -505,6 +698,7 @@ void Content::prependContent(std::unique_ptr<KMime::Content> &&content)
         // If the content was part of something else, this will remove it from there.
         c->setParent(this);
     }
+    d->updateChildIndexes();
 }
 
 std::unique_ptr<Content> Content::takeContent(Content *c)
@@ -519,7 +713,9 @@ std::unique_ptr<Content> Content::takeContent(Content *c)
     }
 
     d->multipartContents.removeAll(c);
+    d->updateChildIndexes(std::max(c->d_ptr->indexInParent, 0));
     c->d_ptr->parent = nullptr;
+    c->d_ptr->indexInParent = -1;
     return std::unique_ptr<Content>(c);
 }
 
@@ -535,6 +731,7 @@ void Content::changeEncoding(Headers::contentEncoding e)
         return;
     }
 
+    d_ptr->invalidateBodyCaches();
     if (d_ptr->decodeText(this)) {
         // This is textual content.  Textual content is stored decoded.
         Q_ASSERT(d_ptr->m_decoded);
@@ -616,38 +813,51 @@ bool Content::hasHeader(QByteArrayView type) const
 
 qsizetype Content::size() const
 {
-    const auto ret = d_ptr->body.size();
-
-    if (const auto cte = contentTransferEncoding(); cte && cte->encoding() == Headers::CEbase64) {
-        KCodecs::Codec *codec = KCodecs::Codec::codecForName("base64");
-        return codec->maxEncodedSizeFor(ret);
+    Q_D(const Content);
+    if (d->body.isEmpty()) {
+        return 0;
     }
 
-    // Not handling quoted-printable here since that requires actually
-    // converting the content, and that is O(size_of_content).
-    // For quoted-printable, this is only an approximate size.
-
-    return ret;
+    const auto cte = contentTransferEncoding();
+    if (!cte || !d->needToEncode(this)) {
+        return d->body.size();
+    }
+    if (const auto cached = d->cachedEncodedBody(cte->encoding()); !cached.isNull()) {
+        return cached.size();
+    }
+    if (cte->encoding() == Headers::CEquPr) {
+        return quotedPrintableEncodedSize(d->body);
+    }
+    return base64EncodedSize(d->body.size()) + 1; // encodedBody() terminates the last line
 }
 
 qsizetype Content::storageSize() const
 {
-    const Q_D(Content);
-    auto s = d->head.size();
+    return encodedContentSize(NewlineType::LF);
+}
+
+qsizetype Content::encodedContentSize(NewlineType newline) const
+{
+    EncodedSizeAccumulator acc;
+    d_ptr->accumulateEncodedContentSize(this, acc);
+    return acc.size(newline);
+}
 
-    if (d->contents().isEmpty()) {
-        s += d->body.size();
-    } else {
+ContentPrivate::~ContentPrivate()
+{
+    invalidateBodyCaches();
+}
 
-        // FIXME: This should take into account the boundary headers that are added in
-        //        encodedContent!
-        const auto contents = d->contents();
-        for (Content *c : contents) {
-            s += c->storageSize();
-        }
+QStringDecoder ContentPrivate::textDecoder(const Content *q)
+{
+    QStringDecoder codec;
+    if (const auto ct = q->contentType(); ct) {
+        codec = makeDecoder(ct->charset());
     }
-
-    return s;
+    if (!codec.isValid()) {   // no suitable codec found => try local settings and hope for the best ;-)
+        codec = QStringDecoder(QStringDecoder::System);
+    }
+    return codec;
 }
 
 bool ContentPrivate::needToEncode(const Content *q) const
@@ -656,28 +866,27 @@ bool ContentPrivate::needToEncode(const Content *q) const
     return m_decoded && cte && (cte->encoding() == Headers::CEquPr || cte->encoding() == Headers::CEbase64);
 }
 
-bool ContentPrivate::decodeText(const Content *q)
+// removes the transfer encoding enc from the text in data, in place where possible
+static void decodeTextInPlace(const Headers::ContentTransferEncoding *enc, QByteArray &data)
 {
-    const Headers::ContentTransferEncoding *enc = q->contentTransferEncoding();
-
-    if (const auto ct = q->contentType(); ct && (!ct->isText() || ct->isSubtype("pgp"))) {
-        // content of type text/pgp might be a binary blob of encrypted text; it must not be decoded as text
-        return false; //non textual data cannot be decoded here => use decodedBody() instead
-    }
-    if (m_decoded) {
-        return true; //nothing to do
-    }
-
+    // decode in place where possible, reusing the buffer of data unless that is shared
     if (enc) {
         switch (enc->encoding()) {
-        case Headers::CEbase64 :
-            body = KCodecs::base64Decode(body);
+        case Headers::CEbase64 : {
+            // the same decoder as decodedBody(), it stops at the first padding character;
+            // it never writes ahead of what it has read, so it can decode in place
+            QScopedPointer<KCodecs::Decoder> decoder(KCodecs::Codec::codecForName("base64")->makeDecoder());
+            char *out = data.data();
+            const char *in = out;
+            decoder->decode(in, in + data.size(), out, in + data.size());
+            data.truncate(out - data.constData());
             break;
+        }
         case Headers::CEquPr :
-            body = KCodecs::quotedPrintableDecode(body);
+            quotedPrintableDecodeInPlace(data);
             break;
         case Headers::CEuuenc :
-            body = KCodecs::uudecode(body);
+            data = KCodecs::uudecode(data);
             break;
         case Headers::CEbinary :
             // nothing to decode
@@ -685,13 +894,294 @@ bool ContentPrivate::decodeText(const Content *q)
             break;
         }
     }
-    if (!body.endsWith('\n')) {
-        body.append('\n');
+    if (!data.endsWith('\n')) {
+        data.append('\n');
+    }
+}
+
+bool ContentPrivate::decodeText(const Content *q)
+{
+    if (!isDecodableText(q)) {
+        return false; //non textual data cannot be decoded here => use decodedBody() instead
+    }
+    if (m_decoded) {
+        return true; //nothing to do
     }
+
+    invalidateBodyCaches();
+    decodeTextInPlace(q->contentTransferEncoding(), body);
     m_decoded = true;
     return true;
 }
 
+bool ContentPrivate::decodedTextBody(const Content *q, QByteArray &text) const
+{
+    if (!isDecodableText(q)) {
+        return false;
+    }
+    text = body;
+    if (!m_decoded) {
+        decodeTextInPlace(q->contentTransferEncoding(), text);
+    }
+    return true;
+}
+
+QByteArray ContentPrivate::cachedEncodedBody(Headers::contentEncoding enc) const
+{
+    QMutexLocker locker(&encodedBodyCacheLock(this));
+    if (!encodedBodyCache.isEmpty() && encodedBodyEncoding == enc) {
+        return encodedBodyCache;
+    }
+    return {};
+}
+
+QByteArray ContentPrivate::encodeBody(Headers::contentEncoding enc) const
+{
+    if (auto cached = cachedEncodedBody(enc); !cached.isNull()) {
+        return cached;
+    }
+
+    QByteArray encoded;
+    if (enc == Headers::CEquPr) {
+        encoded = KCodecs::quotedPrintableEncode(body, false);
+    } else {
+        KCodecs::base64Encode(body, encoded, true);
+        encoded += '\n';
+    }
+
+    // only keep the result around if that doesn't exceed the cache budget
+    QMutexLocker locker(&encodedBodyCacheLock(this));
+    if (!encodedBodyCache.isEmpty()) {
+        s_encodedBodyCacheSize.fetch_sub(encodedBodyCache.size(), std::memory_order_relaxed);
+        encodedBodyCache = QByteArray();
+    }
+    const auto size = encoded.size();
+    if (s_encodedBodyCacheSize.fetch_add(size, std::memory_order_relaxed) + size <= ENCODED_BODY_CACHE_BUDGET) {
+        encodedBodyCache = encoded;
+        encodedBodyEncoding = static_cast<quint8>(enc);
+    } else {
+        s_encodedBodyCacheSize.fetch_sub(size, std::memory_order_relaxed);
+    }
+    return encoded;
+}
+
+void ContentPrivate::invalidateBodyCaches() const
+{
+    DecodedContentCachePrivate::remove(this);
+
+    QMutexLocker locker(&encodedBodyCacheLock(this));
+    if (!encodedBodyCache.isEmpty()) {
+        s_encodedBodyCacheSize.fetch_sub(encodedBodyCache.size(), std::memory_order_relaxed);
+        encodedBodyCache = QByteArray();
+    }
+}
+
+qsizetype ContentPrivate::decodedBodySize(const Content *q)
+{
+    const ContentPrivate *const d = q->d_ptr.get();
+    // this has to match Content::decodedBody()
+    if (d->bodyAsMessage) {
+        return d->bodyAsMessage->encodedContentSize();
+    }
+    if (d->body.isEmpty()) {
+        return 0;
+    }
+    const auto ec = q->contentTransferEncoding();
+    if (!ec || d->m_decoded) {
+        return d->body.size();
+    }
+
+    const QByteArrayView body(d->body);
+    qsizetype size = body.size();
+    switch (ec->encoding()) {
+    case Headers::CEbase64: {
+        // each character of the base64 alphabet carries 6 bits, the decoder skips
+        // everything else and stops at the first padding character
+        const auto isBase64Char = [](char c) {
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/';
+        };
+        const auto end = std::find(body.begin(), body.end(), '=');
+        return std::count_if(body.begin(), end, isBase64Char) * 6 / 8;
+    }
+    case Headers::CEquPr: {
+        // follows KCodecs::quotedPrintableDecode(): soft line breaks and escapes
+        // are only recognized with two more characters following the '=', every
+        // other '=' is dropped
+        const auto isHexDigit = [](char c) {
+            return std::isxdigit(static_cast<unsigned char>(c));
+        };
+        size = 0;
+        bool endsWithNewline = false;
+        for (qsizetype i = 0; i < body.size(); ++i) {
+            if (body[i] != '=') {
+                ++size;
+                endsWithNewline = body[i] == '\n';
+            } else if (i < body.size() - 2) {
+                if (body[i + 1] == '\n') {
+                    ++i;
+                } else if (body[i + 1] == '\r' && body[i + 2] == '\n') {
+                    i += 2;
+                } else if (isHexDigit(body[i + 1]) && isHexDigit(body[i + 2])) {
+                    ++size;
+                    endsWithNewline = body[i + 1] == '0' && (body[i + 2] == 'A' || body[i + 2] == 'a');
+                    i += 2;
+                }
+            }
+        }
+        // decodedBody() removes the trailing newline of the decoded result
+        return endsWithNewline ? size - 1 : size;
+    }
+    case Headers::CEuuenc:
+        return q->decodedBody().size();
+    case Headers::CEbinary:
+        return size;
+    default:
+        break;
+    }
+
+    // decodedBody() removes the trailing newline of everything but binary content
+    if (d->body.endsWith('\n')) {
+        --size;
+    }
+    return size;
+}
+
+void ContentPrivate::accumulateEncodedBodySize(const Content *q, EncodedSizeAccumulator &acc) const
+{
+    // this has to match Content::encodedBody()
+    if (frozen) {
+        acc.append(frozenBody.isEmpty() ? body : frozenBody);
+    } else if (q->bodyIsMessage() && bodyAsMessage) {
+        bodyAsMessage->d_ptr->accumulateEncodedContentSize(bodyAsMessage.get(), acc);
+    } else if (!body.isEmpty()) {
+        const auto enc = q->contentTransferEncoding();
+        if (enc && needToEncode(q)) {
+            qsizetype lineBreaks = 0;
+            if (const auto cached = cachedEncodedBody(enc->encoding()); !cached.isNull()) {
+                acc.append(cached);
+            } else if (enc->encoding() == Headers::CEquPr) {
+                // line breaks are passed through unchanged and CRs are always encoded,
+                // so the input tells us everything we need to know about line breaks
+                // at the start and the end of the output
+                const auto size = quotedPrintableEncodedSize(body, &lineBreaks);
+                acc.appendEncoded(size, lineBreaks, QByteArrayView(body).first(std::min<qsizetype>(body.size(), 2)),
+                                 body.back() == '\n' ? '\n' : '\0');
+            } else {
+                // base64 output never starts with a line break, but always ends with one
+                const auto size = base64EncodedSize(body.size(), &lineBreaks);
+                acc.appendEncoded(size + 1, lineBreaks + 1, {}, '\n');
+            }
+        } else {
+            acc.append(body);
+        }
+    }
+
+    if (!frozen && !multipartContents.isEmpty()) {
+        const auto ct = q->contentType();
+        const QByteArray boundary = ct ? ct->boundary() : QByteArray();
+
+        acc.append(preamble);
+        for (const Content *c : multipartContents) {
+            acc.append("\n--");
+            acc.append(boundary);
+            acc.append("\n");
+            c->d_ptr->accumulateEncodedContentSize(c, acc);
+        }
+        acc.append("\n--");
+        acc.append(boundary);
+        acc.append("--\n");
+        acc.append(epilogue);
+    }
+}
+
+void ContentPrivate::accumulateEncodedContentSize(const Content *q, EncodedSizeAccumulator &acc) const
+{
+    // this has to match Content::encodedContent()
+    EncodedSizeAccumulator bodySize;
+    accumulateEncodedBodySize(q, bodySize);
+
+    acc.append(head);
+    if (!head.endsWith("\n\n") &&
+        !bodySize.startsWith("\n\n") &&
+        !(head.endsWith('\n') && bodySize.startsWith("\n"))) {
+        acc.append("\n");
+    }
+    acc.append(bodySize);
+}
+
+void EncodedSizeAccumulator::append(QByteArrayView data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    for (qsizetype i = 0; m_size + i < 2 && i < data.size(); ++i) {
+        m_leading[m_size + i] = data[i];
+    }
+    if (!m_firstLineBreakFound) {
+        if (const auto idx = data.indexOf('\n'); idx >= 0) {
+            m_firstLineBreakFound = true;
+            m_firstLineBreakIsCRLF = (idx > 0 ? data[idx - 1] : m_last) == '\r';
+        }
+    }
+    m_lineBreaks += data.count('\n');
+    m_size += data.size();
+    m_last = data.back();
+}
+
+void EncodedSizeAccumulator::append(const EncodedSizeAccumulator &other)
+{
+    if (other.m_size == 0) {
+        return;
+    }
+
+    for (qsizetype i = 0; m_size + i < 2 && i < other.m_size; ++i) {
+        m_leading[m_size + i] = other.m_leading[i];
+    }
+    if (!m_firstLineBreakFound && other.m_firstLineBreakFound) {
+        m_firstLineBreakFound = true;
+        m_firstLineBreakIsCRLF = other.m_leading[0] == '\n' ? m_last == '\r' : other.m_firstLineBreakIsCRLF;
+    }
+    m_lineBreaks += other.m_lineBreaks;
+    m_size += other.m_size;
+    m_last = other.m_last;
+}
+
+void EncodedSizeAccumulator::appendEncoded(qsizetype size, qsizetype lineBreaks, QByteArrayView leading, char last)
+{
+    if (size == 0) {
+        return;
+    }
+
+    // bytes not in leading are known not to be line breaks
+    for (qsizetype i = 0; m_size + i < 2 && i < size; ++i) {
+        m_leading[m_size + i] = i < leading.size() ? leading[i] : '\0';
+    }
+    if (!m_firstLineBreakFound && lineBreaks > 0) {
+        m_firstLineBreakFound = true;
+        m_firstLineBreakIsCRLF = !leading.isEmpty() && leading[0] == '\n' && m_last == '\r';
+    }
+    m_lineBreaks += lineBreaks;
+    m_size += size;
+    m_last = last;
+}
+
+bool EncodedSizeAccumulator::startsWith(QByteArrayView prefix) const
+{
+    Q_ASSERT(prefix.size() <= 2);
+    return m_size >= prefix.size() && QByteArrayView(m_leading, prefix.size()) == prefix;
+}
+
+qsizetype EncodedSizeAccumulator::size(NewlineType newline) const
+{
+    // LFtoCRLF() leaves data alone if it already uses CRLF line breaks,
+    // judging by the first line break only
+    if (newline == NewlineType::CRLF && m_firstLineBreakFound && !m_firstLineBreakIsCRLF) {
+        return m_size + m_lineBreaks;
+    }
+    return m_size;
+}
+
 int ContentPrivate::depth() const
 {
     int d = 0;
@@ -703,36 +1193,30 @@ int ContentPrivate::depth() const
 
 Content *KMime::Content::content(const ContentIndex &index) const
 {
-    if (!index.isValid()) {
-        return const_cast<KMime::Content *>(this);
-    }
-    ContentIndex idx = index;
-    unsigned int i = idx.pop() - 1; // one-based -> zero-based index
-    if (i < static_cast<unsigned int>(d_ptr->contents().size())) {
-        return d_ptr->contents().at(i)->content(idx);
-    } else {
-        return nullptr;
+    auto c = const_cast<KMime::Content *>(this);
+    for (qsizetype level = 0; c && level < index.size(); ++level) {
+        const unsigned int i = index.at(level) - 1; // one-based -> zero-based index
+        const auto children = c->d_ptr->children();
+        c = i < static_cast<unsigned int>(children.size()) ? children[i] : nullptr;
     }
+    return c;
 }
 
 ContentIndex KMime::Content::indexForContent(const Content *content) const
 {
-    const auto idx = d_ptr->contents().indexOf(content);
-    if (idx >= 0) {
-        ContentIndex ci;
-        ci.push(idx + 1);   // zero-based -> one-based index
-        return ci;
+    if (!content) {
+        return {};
     }
-    // not found, we need to search recursively
-    for (int i = 0; i < d_ptr->contents().size(); ++i) {
-        ContentIndex ci = d_ptr->contents().at(i)->indexForContent(content);
-        if (ci.isValid()) {
-            // found it
-            ci.push(i + 1);   // zero-based -> one-based index
-            return ci;
+
+    // walk up from content, as each Content knows its position in its parent
+    ContentIndex ci;
+    for (auto c = content; c != this; c = c->d_ptr->parent) {
+        if (!c->d_ptr->parent || c->d_ptr->indexInParent < 0) {
+            return {}; // not found
         }
+        ci.push(c->d_ptr->indexInParent + 1);   // zero-based -> one-based index
     }
-    return {}; // not found
+    return ci;
 }
 
 bool Content::isTopLevel() const
@@ -745,15 +1229,16 @@ void Content::setParent(Content *parent)
     // Make sure the Content is only in the contents list of one parent object
     Content *oldParent = d_ptr->parent;
     if (oldParent) {
-        if (!oldParent->contents().isEmpty() && oldParent->contents().contains(this)) {
+        if (oldParent->d_ptr->children().contains(this)) {
             oldParent->takeContent(this).release();
         }
     }
 
     d_ptr->parent = parent;
     if (parent) {
-        if (!parent->contents().isEmpty() && !parent->contents().contains(this)) {
+        if (const auto children = parent->d_ptr->children(); !children.isEmpty() && !children.contains(this)) {
             parent->d_ptr->multipartContents.append(this);
+            d_ptr->indexInParent = parent->d_ptr->multipartContents.size() - 1;
         }
     }
 }
@@ -788,12 +1273,7 @@ const Content *Content::topLevel() const
 
 ContentIndex Content::index() const
 {
-    auto top = topLevel();
-    if (top) {
-        return top->indexForContent(const_cast<Content *>(this));
-    }
-
-    return indexForContent(const_cast<Content *>(this));
+    return topLevel()->indexForContent(this);
 }
 
 std::shared_ptr<Message> Content::bodyAsMessage()
@@ -838,6 +1318,11 @@ kmime_mk_header_accessor(ContentID, contentID)
 #undef kmime_mk_header_accessor
 // @endcond
 
+ContentChildren ContentPrivate::children(const Content *q)
+{
+    return q->d_ptr->children();
+}
+
 QList<Content *> ContentPrivate::contents() const {
     Q_ASSERT(multipartContents.isEmpty() || !bodyAsMessage);
     if (bodyAsMessage) {
@@ -847,6 +1332,28 @@ QList<Content *> ContentPrivate::contents() const {
     }
 }
 
+void ContentPrivate::updateChildIndexes(qsizetype from)
+{
+    for (auto i = from; i < multipartContents.size(); ++i) {
+        multipartContents[i]->d_ptr->indexInParent = int(i);
+    }
+}
+
+QList<Headers::Base *> ContentPrivate::replaceHeaders(Content *q)
+{
+    auto oldHeaders = std::exchange(headers, HeaderParsing::parseHeaders(head));
+    if (const auto cte = q->contentTransferEncoding(DontCreate); cte) {
+        m_decoded = (cte->encoding() == Headers::CE7Bit || cte->encoding() == Headers::CE8Bit);
+    }
+
+    Headers::ContentType *ct = q->contentType();
+    if (ct->isEmpty()) { //Set default content-type as defined in https://tools.ietf.org/html/rfc2045#page-10 (5.2.  Content-Type Defaults)
+        ct->setMimeType("text/plain");
+        ct->setCharset("us-ascii");
+    }
+    return oldHeaders;
+}
+
 bool ContentPrivate::parseUuencoded(Content *q)
 {
     Parser::UUEncoded uup(body, head);
@@ -993,15 +1500,36 @@ bool ContentPrivate::parseMultipart(Content *q)
 
 void ContentPrivate::cloneInto(Content *content, const ContentPrivate *other)
 {
-    *content->d_ptr = *other;
+    content->d_ptr->invalidateBodyCaches();
+    {
+        // other might be read by other threads while it is being cloned
+        QMutexLocker locker(&encodedBodyCacheLock(other));
+        *content->d_ptr = *other;
+    }
+    // the clone isn't accounted for in the encoded body cache budget
+    content->d_ptr->encodedBodyCache = QByteArray();
     content->d_ptr->parent = nullptr;
+    content->d_ptr->indexInParent = -1;
+
+    // the byte arrays above are implicitly shared, the tree and the headers need a deep copy
     content->d_ptr->multipartContents.clear();
+    content->d_ptr->multipartContents.reserve(other->multipartContents.size());
     for (const auto &p : other->multipartContents) {
-        content->appendContent(p->clone());
+        auto c = p->clone();
+        c->d_ptr->parent = content;
+        c->d_ptr->indexInParent = content->d_ptr->multipartContents.size();
+        content->d_ptr->multipartContents.append(c.release());
+    }
+    if (other->bodyAsMessage) {
+        std::shared_ptr<Message> message = clone(other->bodyAsMessage.get());
+        message->d_ptr->parent = content;
+        message->d_ptr->indexInParent = 0;
+        content->d_ptr->bodyAsMessage = std::move(message);
     }
     content->d_ptr->headers.clear();
+    content->d_ptr->headers.reserve(other->headers.size());
     for (const auto h : other->headers) {
-        content->appendHeader(HeaderFactory::clone(h));
+        content->d_ptr->headers.append(HeaderFactory::clone(h).release());
     }
 }
 
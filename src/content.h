@@ -19,6 +19,7 @@
 #include <QList>
 #include <QMetaType>
 
+#include <functional>
 #include <memory>
 #include <span>
 
@@ -153,9 +154,31 @@ public:
    * \note To avoid unbound recursion, there is a safety depth limit, beyond that
    *       parts or encapsulated messages will no longer be parsed but appear as
    *       a Content object with unparsed content.
+   *
+   * Only this Content and the ones below it are parsed, so to update a single
+   * part of a message, call setContent() and parse() on that sub-Content
+   * rather than on the whole message. Use parseHeaders() if only the head
+   * has changed.
    */
   void parse();
 
+  /*!
+    Parses the head of the Content again, after it has been changed by setHead().
+
+    Unlike parse(), this keeps the body, the sub-Contents and the encapsulated
+    message as they are, so any pointers to them stay valid. This only works
+    as long as the new head still describes the same kind of body; if e.g. a
+    multipart Content is changed to a text Content, the body is assembled
+    with the previous headers and the whole Content is parsed again.
+
+    \note Unlike parse(), this does not look for uuencoded or yEnc content
+    in the body of a text Content again.
+
+    \sa parse()
+    \since 26.08
+  */
+  void parseHeaders();
+
   /*!
     Returns whether this Content is frozen.
 
@@ -216,7 +239,7 @@ public:
     Sets the Content header raw data.
 
     This method operates on the string representation of the Content. Call
-    parse() if you want to access individual headers.
+    parseHeaders() or parse() if you want to access individual headers.
 
     \a head is a QByteArray containing the header data.
 
@@ -433,17 +456,30 @@ public:
   /*!
     Returns the size of the Content body after encoding.
 
-    (If the encoding is quoted-printable, this is only an approximate size.)
+    The size is computed without actually encoding the body.
 
     This will return 0 for multipart contents or for encapsulated messages.
   */
   [[nodiscard]] qsizetype size() const;
 
   /*!
-    Returns the size of this Content and all sub-Contents.
+    Returns the size of this Content and all sub-Contents, including
+    headers and multipart boundaries.
+
+    This is the same as encodedContentSize(NewlineType::LF).
   */
   [[nodiscard]] qsizetype storageSize() const;
 
+  /*!
+    Returns the exact size of the data returned by encodedContent(),
+    without creating any encoded data.
+
+     newline whether to use CRLF for linefeeds, or LF (default is LF).
+
+    \since 26.08
+  */
+  [[nodiscard]] qsizetype encodedContentSize(NewlineType newline = NewlineType::LF) const;
+
   /*!
     Returns the Content body raw data.
 
@@ -581,6 +617,26 @@ public:
   */
   [[nodiscard]] QString decodedText(DecodedTextTrimOption trimOption = NoTrim) const;
 
+  /*!
+    Decodes the text like decodedText(), but passes it to \a callback in
+    chunks of limited size rather than returning it as one string.
+
+    This allows processing huge text parts without holding their entire
+    decoded text in memory. Base64 and quoted-printable encoded bodies are
+    transfer-decoded chunk by chunk as well. The chunks are only valid for the duration of
+    the respective \a callback invocation. Trimming is applied to the end
+    of the entire text, not to the individual chunks.
+
+    \a trimOption Control how to trim trailing white spaces.
+    The last trailing new line of the decoded text is always removed.
+
+    Returns \c false if this is not a text Content, \a callback is not
+    called then.
+
+    \since 26.08
+  */
+  bool decodedTextChunks(const std::function<void(QStringView)> &callback, DecodedTextTrimOption trimOption = NoTrim) const;
+
   /*!
     Sets the Content body to the given string using charset of the content type.
 
@@ -6,8 +6,14 @@
 
 #pragma once
 
+#include "headers.h"
+
 #include <QByteArray>
 #include <QList>
+#include <QStringDecoder>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 //@cond PRIVATE
 
@@ -19,12 +25,149 @@ namespace Headers {
 class Base;
 }
 
+/**
+  Computes the size of serialized content piece by piece without creating it.
+  Besides the size this tracks what is needed to predict the effect of the
+  head/body separator logic in Content::encodedContent() and of LFtoCRLF().
+*/
+class EncodedSizeAccumulator
+{
+public:
+    void append(QByteArrayView data);
+    void append(const EncodedSizeAccumulator &other);
+    /**
+      Appends transfer-encoded data without line breaks preceded by CR.
+      @param leading The first (up to) two bytes of the encoded data.
+    */
+    void appendEncoded(qsizetype size, qsizetype lineBreaks, QByteArrayView leading, char last);
+
+    [[nodiscard]] bool startsWith(QByteArrayView prefix) const;
+    [[nodiscard]] qsizetype size(NewlineType newline) const;
+
+private:
+    qsizetype m_size = 0;
+    qsizetype m_lineBreaks = 0;
+    char m_leading[2] = {0, 0};
+    char m_last = 0;
+    bool m_firstLineBreakFound = false;
+    bool m_firstLineBreakIsCRLF = false;
+};
+
+/**
+  The child Contents of a Content, as returned by Content::contents(),
+  without creating a list. Only valid as long as the children aren't changed.
+*/
+class ContentChildren
+{
+public:
+    explicit ContentChildren(const QList<Content *> &list)
+        : m_data(list.constData())
+        , m_size(list.size())
+    {
+    }
+    explicit ContentChildren(Content *message)
+        : m_message(message)
+        , m_size(1)
+    {
+    }
+
+    [[nodiscard]] Content *const *begin() const
+    {
+        return m_message ? &m_message : m_data;
+    }
+    [[nodiscard]] Content *const *end() const
+    {
+        return begin() + m_size;
+    }
+    [[nodiscard]] qsizetype size() const
+    {
+        return m_size;
+    }
+    [[nodiscard]] bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+    [[nodiscard]] Content *operator[](qsizetype i) const
+    {
+        return begin()[i];
+    }
+    [[nodiscard]] bool contains(const Content *content) const
+    {
+        return std::find(begin(), end(), content) != end();
+    }
+
+private:
+    Content *const *m_data = nullptr;
+    Content *m_message = nullptr;
+    qsizetype m_size = 0;
+};
+
+/** Controls how ContentPrivate::walk() continues after visiting a Content. */
+enum class WalkResult {
+    Continue, ///< visit the children of the Content next
+    SkipChildren, ///< don't visit the children of the Content
+    Stop, ///< end the walk
+};
+
+/** What a Content is used for within a message, see classifyParts(). */
+enum class PartRole : quint8 {
+    Body = 0x01, ///< the main body part, see Content::textContent()
+    Attachment = 0x02, ///< see KMime::isAttachment()
+    Crypto = 0x04, ///< see KMime::isCryptoPart()
+    Invitation = 0x08, ///< see KMime::isInvitation()
+    RelatedInline = 0x10, ///< below a multipart/related, and thus never an attachment
+    Signed = 0x20, ///< makes the walked message signed, see KMime::isSigned()
+    Encrypted = 0x40, ///< makes the walked message encrypted, see KMime::isEncrypted()
+};
+Q_DECLARE_FLAGS(PartRoles, PartRole)
+
+/**
+  Determines the PartRoles of the Contents visited by classifyParts(),
+  with the main body part of the message looked up only once.
+*/
+class PartClassifier
+{
+public:
+    /** Only the roles in @p wanted are determined and reported. */
+    explicit PartClassifier(const Content *root, PartRoles wanted);
+
+    /** Returns the roles of @p c, which has to be visited in walk order. */
+    [[nodiscard]] PartRoles roles(const Content *c) const;
+    /** Returns whether the children of @p c are to be classified as well. */
+    [[nodiscard]] bool enter(const Content *c);
+    /** Has to be called after the children of @p c have been visited or skipped. */
+    void leave(const Content *c);
+
+private:
+    [[nodiscard]] bool isOnMainPath(const Content *c) const;
+
+    const Content *const m_root;
+    const PartRoles m_wanted;
+    const Content *const m_mainBodyPart;
+    // the outermost multipart/related being walked, its parts are never attachments
+    const Content *m_related = nullptr;
+    // the innermost multipart entered on the way to the main body parts of
+    // m_root, whose children decide about PartRole::Signed and Encrypted
+    const Content *m_mainPath = nullptr;
+    bool m_mainPathAlternative = false;
+};
+
 class ContentPrivate
 {
 public:
     explicit ContentPrivate() = default;
-    ~ContentPrivate() = default;
+    // copying would duplicate encodedBodyCache without accounting for it in
+    // the cache budget, cloneInto() resets it after assigning
+    ContentPrivate(const ContentPrivate &) = delete;
+    ~ContentPrivate();
+    ContentPrivate &operator=(const ContentPrivate &) = default;
 
+    /**
+      Replaces the headers of @p q by the ones parsed from head, and updates
+      the state derived from them. The body and the sub-Contents are left alone.
+      @return the previous headers, to be deleted by the caller.
+    */
+    [[nodiscard]] QList<Headers::Base *> replaceHeaders(Content *q);
     bool parseUuencoded(Content *q);
     bool parseYenc(Content *q);
     bool parseMultipart(Content *q);
@@ -37,11 +180,77 @@ public:
     [[nodiscard]] bool needToEncode(const Content *q) const;
 
     [[nodiscard]] bool decodeText(const Content *q);
+    /**
+      Provides the body of the text content @p q without its transfer encoding
+      in @p text. Unlike decodeText() this leaves the Content untouched, and is
+      thus safe to use from const methods.
+      @returns false if @p q is not a text content
+    */
+    [[nodiscard]] bool decodedTextBody(const Content *q, QByteArray &text) const;
+    /**
+      Returns a decoder for the charset of the text content @p q,
+      falling back to the system charset.
+    */
+    [[nodiscard]] static QStringDecoder textDecoder(const Content *q);
+
+    /**
+      Returns body encoded with the transfer encoding @p enc (base64 or
+      quoted-printable), reusing the cached result of a previous call
+      if possible.
+    */
+    [[nodiscard]] QByteArray encodeBody(Headers::contentEncoding enc) const;
+    /** Returns the cached result of encodeBody() for @p enc, a null byte array if there is none. */
+    [[nodiscard]] QByteArray cachedEncodedBody(Headers::contentEncoding enc) const;
+    /**
+      Drops the cached encoded body, and the decoded forms of body held by
+      the DecodedContentCache. Has to be called whenever body or its
+      transfer encoding changes.
+    */
+    void invalidateBodyCaches() const;
+
+    /**
+      Returns the exact size of decodedBody() of @p q. Base64 and
+      quoted-printable encoded bodies are sized by scanning them the way
+      the decoders do, without decoding them. For an encapsulated message,
+      for which decodedBody() is empty, this is its encoded size instead.
+    */
+    [[nodiscard]] static qsizetype decodedBodySize(const Content *q);
+
+    void accumulateEncodedBodySize(const Content *q, EncodedSizeAccumulator &acc) const;
+    void accumulateEncodedContentSize(const Content *q, EncodedSizeAccumulator &acc) const;
 
     // This one returns the normal multipartContents for multipart contents, but returns
     // a list with just bodyAsMessage in it for contents that are encapsulated messages.
     // That makes it possible to handle encapsulated messages in a transparent way.
     QList<Content *> contents() const;
+    /** Same as contents(), without creating a list. */
+    [[nodiscard]] ContentChildren children() const
+    {
+        return bodyAsMessage ? ContentChildren(bodyAsMessage.get()) : ContentChildren(multipartContents);
+    }
+    [[nodiscard]] static ContentChildren children(const Content *q);
+
+    /**
+      Walks the tree starting at @p root depth-first, without recursion.
+      @param pre called for every Content before its children, decides whether
+      those are visited
+      @param post called for every Content after its children have been visited
+      or skipped
+      @returns false if the walk was ended by @p pre returning WalkResult::Stop
+    */
+    template <typename PreVisitor, typename PostVisitor>
+    static bool walk(const Content *root, PreVisitor &&pre, PostVisitor &&post);
+    template <typename PreVisitor>
+    static bool walk(const Content *root, PreVisitor &&pre)
+    {
+        return walk(root, std::forward<PreVisitor>(pre), [](const Content *) {});
+    }
+    /**
+      Updates the indexInParent of the multipartContents starting at @p from.
+      Has to be called whenever Contents are inserted into or removed from
+      multipartContents.
+    */
+    void updateChildIndexes(qsizetype from = 0);
 
     template <typename T>
     [[nodiscard]] static std::unique_ptr<T> clone(const T *content)
@@ -60,6 +269,8 @@ public:
     QByteArray frozenBody;
     QByteArray preamble;
     QByteArray epilogue;
+    // transfer-encoded form of body, see encodeBody(), guarded by a lock as it is filled by const methods
+    mutable QByteArray encodedBodyCache;
     Content *parent = nullptr;
 
     QList<Content *> multipartContents;
@@ -67,12 +278,85 @@ public:
 
     QList<Headers::Base *> headers;
 
+    // position of this Content in the contents() of parent, -1 if it isn't in there
+    int indexInParent = -1;
+
     bool frozen : 1 = false;
     // Indicates whether body has content transfer encoding applied or not
-    mutable bool m_decoded : 1 = true;
+    bool m_decoded : 1 = true;
+    // transfer encoding encodedBodyCache has been created with, a Headers::contentEncoding;
+    // not part of the bit field above, as it is written while other threads read those bits
+    mutable quint8 encodedBodyEncoding = Headers::CE7Bit;
 };
 
+template <typename PreVisitor, typename PostVisitor>
+bool ContentPrivate::walk(const Content *root, PreVisitor &&pre, PostVisitor &&post)
+{
+    struct Level {
+        const Content *content;
+        qsizetype nextChild;
+    };
+    QVarLengthArray<Level, 16> stack;
+
+    const auto enter = [&](const Content *content) {
+        switch (pre(content)) {
+        case WalkResult::Stop:
+            return false;
+        case WalkResult::SkipChildren:
+            post(content);
+            break;
+        case WalkResult::Continue:
+            stack.push_back({content, 0});
+            break;
+        }
+        return true;
+    };
+
+    if (!enter(root)) {
+        return false;
+    }
+    while (!stack.isEmpty()) {
+        auto &level = stack.back();
+        const auto children = ContentPrivate::children(level.content);
+        if (level.nextChild < children.size()) {
+            // level is invalidated by entering the child
+            if (!enter(children[level.nextChild++])) {
+                return false;
+            }
+        } else {
+            const auto content = level.content;
+            stack.pop_back();
+            post(content);
+        }
+    }
+    return true;
+}
+
+/**
+  Classifies @p root and the Contents below it in a single depth-first walk.
+  Like Content::attachments() and KMime::hasAttachment(), this descends into
+  multipart Contents only.
+  @param wanted the roles @p visitor looks at, checks for any other roles are skipped
+  @param visitor called as bool(const Content *, PartRoles) for every Content,
+  returning false ends the walk
+*/
+template <typename Visitor>
+void classifyParts(const Content *root, PartRoles wanted, Visitor &&visitor)
+{
+    PartClassifier classifier(root, wanted);
+    ContentPrivate::walk(root, [&](const Content *c) {
+        if (!visitor(c, classifier.roles(c))) {
+            return WalkResult::Stop;
+        }
+        return classifier.enter(c) ? WalkResult::Continue : WalkResult::SkipChildren;
+    }, [&classifier](const Content *c) {
+        classifier.leave(c);
+    });
 }
 
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KMime::PartRoles)
+
 //@endcond
 
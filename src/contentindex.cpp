@@ -16,20 +16,21 @@
 
 #include "contentindex.h"
 
-#include <QList>
 #include <QSharedData>
-#include <QStringList>
 #include <QStringTokenizer>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
 
 using namespace KMime;
 
 class ContentIndex::Private : public QSharedData
 {
 public:
-  Private() = default;
-  Private(const Private &other) : QSharedData(other) { index = other.index; }
-
-  QList<unsigned int> index;
+  // the part numbers, bottom-most first, so that push() and pop() work on the end
+  QVarLengthArray<unsigned int, 8> index;
 };
 
 KMime::ContentIndex::ContentIndex() : d(new Private)
@@ -43,10 +44,11 @@ KMime::ContentIndex::ContentIndex(QStringView index) : d(new Private)
         unsigned int i = s.toUInt(&ok);
         if (!ok) {
             d->index.clear();
-            break;
+            return;
         }
         d->index.append(i);
     }
+    std::reverse(d->index.begin(), d->index.end());
 }
 
 ContentIndex::ContentIndex(const ContentIndex &other) = default;
@@ -61,27 +63,45 @@ bool KMime::ContentIndex::isValid() const
 
 unsigned int KMime::ContentIndex::pop()
 {
-    return d->index.takeFirst();
+    const auto i = d->index.back();
+    d->index.removeLast();
+    return i;
 }
 
 void KMime::ContentIndex::push(unsigned int index)
 {
-    d->index.prepend(index);
+    d->index.append(index);
 }
 
 unsigned int ContentIndex::up()
 {
-    return d->index.takeLast();
+    const auto i = d->index.front();
+    d->index.remove(0);
+    return i;
+}
+
+qsizetype ContentIndex::size() const
+{
+    return d->index.size();
+}
+
+unsigned int ContentIndex::at(qsizetype level) const
+{
+    return d->index.at(d->index.size() - 1 - level);
 }
 
 QString KMime::ContentIndex::toString() const
 {
-    QStringList l;
-    l.reserve(d->index.count());
-    for (unsigned int i : std::as_const(d->index)) {
-        l.append(QString::number(i));
+    QVarLengthArray<char, 64> buffer;
+    for (auto it = d->index.crbegin(); it != d->index.crend(); ++it) {
+        char digits[std::numeric_limits<unsigned int>::digits10 + 1];
+        const auto result = std::to_chars(std::begin(digits), std::end(digits), *it);
+        if (!buffer.isEmpty()) {
+            buffer.append('.');
+        }
+        buffer.append(digits, result.ptr - digits);
     }
-    return l.join(QLatin1Char('.'));
+    return QString::fromLatin1(buffer.constData(), buffer.size());
 }
 
 bool KMime::ContentIndex::operator ==(const ContentIndex &index) const
@@ -99,5 +119,8 @@ ContentIndex &ContentIndex::operator =(ContentIndex &&) noexcept = default;
 
 size_t KMime::qHash(const KMime::ContentIndex &index, size_t seed) noexcept
 {
-    return qHash(index.toString(), seed);
+    for (qsizetype level = 0; level < index.size(); ++level) {
+        seed ^= qHash(index.at(level)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
 }
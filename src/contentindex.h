@@ -79,6 +79,21 @@ public:
     */
     unsigned int up();
 
+    /*!
+      Returns the number of levels of this content index.
+
+      \since 26.08
+    */
+    [[nodiscard]] qsizetype size() const;
+
+    /*!
+      Returns the one-based part number at \a level, with level 0 being
+      the top-most one. \a level must be less than size().
+
+      \since 26.08
+    */
+    [[nodiscard]] unsigned int at(qsizetype level) const;
+
     /*!
       Returns a string representation of this content index according
       to RFC3501 section 6.4.5.
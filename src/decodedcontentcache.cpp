@@ -0,0 +1,174 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "decodedcontentcache.h"
+#include "decodedcontentcache_p.h"
+
+#include <QCache>
+#include <QMutex>
+
+#include <algorithm>
+#include <atomic>
+
+using namespace KMime;
+
+namespace
+{
+
+struct CacheKey {
+    const void *content;
+    bool text; // decodedText() rather than decodedBody()
+
+    friend bool operator==(const CacheKey &lhs, const CacheKey &rhs) = default;
+    friend size_t qHash(const CacheKey &key, size_t seed = 0) noexcept
+    {
+        return qHashMulti(seed, key.content, key.text);
+    }
+};
+
+struct CacheEntry {
+    QByteArray body;
+    QString text;
+    QByteArray charset;
+    quint8 encoding;
+};
+
+struct Cache {
+    QMutex lock;
+    QCache<CacheKey, CacheEntry> entries{0};
+    quint64 hits = 0;
+    quint64 misses = 0;
+};
+
+}
+
+// checked without taking the lock, so that a disabled cache costs next to nothing
+static std::atomic<bool> s_enabled = false;
+
+static Cache &cache()
+{
+    static Cache c;
+    return c;
+}
+
+// Looks up key, counting hits and misses, with charset only checked for text entries.
+// Has to be called with the lock held.
+static const CacheEntry *find(Cache &c, const CacheKey &key, quint8 encoding, const QByteArray &charset = {})
+{
+    const auto entry = c.entries.object(key);
+    if (entry && entry->encoding == encoding && (!key.text || entry->charset == charset)) {
+        ++c.hits;
+        return entry;
+    }
+    ++c.misses;
+    return nullptr;
+}
+
+void DecodedContentCache::setBudget(qsizetype bytes)
+{
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    c.entries.setMaxCost(std::max<qsizetype>(bytes, 0));
+    if (bytes <= 0) {
+        c.entries.clear();
+    }
+    s_enabled = bytes > 0;
+}
+
+qsizetype DecodedContentCache::budget()
+{
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    return c.entries.maxCost();
+}
+
+DecodedContentCache::Statistics DecodedContentCache::statistics()
+{
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    Statistics stats;
+    stats.hits = c.hits;
+    stats.misses = c.misses;
+    stats.bytes = c.entries.totalCost();
+    stats.entries = c.entries.size();
+    return stats;
+}
+
+void DecodedContentCache::resetStatistics()
+{
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    c.hits = 0;
+    c.misses = 0;
+}
+
+void DecodedContentCache::clear()
+{
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    c.entries.clear();
+}
+
+bool DecodedContentCachePrivate::findBody(const void *key, quint8 encoding, QByteArray &body)
+{
+    if (!s_enabled) {
+        return false;
+    }
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    if (const auto entry = find(c, {key, false}, encoding)) {
+        body = entry->body;
+        return true;
+    }
+    return false;
+}
+
+void DecodedContentCachePrivate::insertBody(const void *key, quint8 encoding, const QByteArray &body)
+{
+    if (!s_enabled) {
+        return;
+    }
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    // takes ownership of the entry, and deletes it right away if it exceeds the budget
+    c.entries.insert({key, false}, new CacheEntry{body, {}, {}, encoding}, body.size());
+}
+
+bool DecodedContentCachePrivate::findText(const void *key, quint8 encoding, const QByteArray &charset, QString &text)
+{
+    if (!s_enabled) {
+        return false;
+    }
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    if (const auto entry = find(c, {key, true}, encoding, charset)) {
+        text = entry->text;
+        return true;
+    }
+    return false;
+}
+
+void DecodedContentCachePrivate::insertText(const void *key, quint8 encoding, const QByteArray &charset, const QString &text)
+{
+    if (!s_enabled) {
+        return;
+    }
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    c.entries.insert({key, true}, new CacheEntry{{}, text, charset, encoding}, text.size() * qsizetype(sizeof(QChar)));
+}
+
+void DecodedContentCachePrivate::remove(const void *key)
+{
+    if (!s_enabled) {
+        return;
+    }
+    auto &c = cache();
+    QMutexLocker locker(&c.lock);
+    c.entries.remove({key, false});
+    c.entries.remove({key, true});
+}
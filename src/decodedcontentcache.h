@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+
+#include <QtGlobal>
+
+namespace KMime
+{
+
+/*!
+  \class KMime::DecodedContentCache
+  \inmodule KMime
+  \inheaderfile KMime/DecodedContentCache
+
+  \brief Controls the cache for decoded Content bodies.
+
+  Content::decodedBody() and Content::decodedText() remove the transfer
+  encoding (and convert the charset, respectively) on every call. With
+  the cache enabled, their results are kept in memory, so that asking
+  for the same part again is cheap. The least recently used results are
+  dropped when the memory budget of the cache is exceeded.
+
+  The cache is shared by all Contents and is disabled by default. Entries
+  of a Content are dropped when its body changes, e.g. by Content::setBody()
+  or Content::changeEncoding(), or when it is deleted. The cache is
+  thread-safe, and is used for messages shared by SharedMessage as well.
+
+  \code
+  KMime::DecodedContentCache::setBudget(64 * 1024 * 1024);
+  \endcode
+
+  \since 26.08
+*/
+class KMIME_EXPORT DecodedContentCache
+{
+public:
+    /*!
+      \class KMime::DecodedContentCache::Statistics
+      \inmodule KMime
+      \brief Usage statistics of the DecodedContentCache.
+    */
+    struct Statistics {
+        /*! Number of lookups served from the cache. */
+        quint64 hits = 0;
+        /*! Number of lookups which had to decode the body. */
+        quint64 misses = 0;
+        /*! Memory currently used by the cached results, in bytes. */
+        qsizetype bytes = 0;
+        /*! Number of currently cached results. */
+        qsizetype entries = 0;
+    };
+
+    /*!
+      Sets the memory budget of the cache to \a bytes. A budget of 0
+      disables the cache and drops all cached results, which is the default.
+    */
+    static void setBudget(qsizetype bytes);
+
+    /*!
+      Returns the memory budget of the cache in bytes, 0 if it is disabled.
+    */
+    [[nodiscard]] static qsizetype budget();
+
+    /*!
+      Returns the usage statistics of the cache.
+    */
+    [[nodiscard]] static Statistics statistics();
+
+    /*!
+      Resets the hit and miss counters of the statistics.
+    */
+    static void resetStatistics();
+
+    /*!
+      Drops all cached results, keeping the budget.
+    */
+    static void clear();
+
+    DecodedContentCache() = delete;
+};
+
+} // namespace KMime
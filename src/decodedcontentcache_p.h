@@ -0,0 +1,43 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "decodedcontentcache.h"
+
+#include <QByteArray>
+#include <QString>
+
+//@cond PRIVATE
+
+namespace KMime
+{
+
+/**
+  Access to the DecodedContentCache for Content. Entries are keyed by the
+  ContentPrivate they were created for, and record the transfer encoding
+  (and the charset) they were decoded with, as those headers can be changed
+  without the Content noticing.
+*/
+class DecodedContentCachePrivate
+{
+public:
+    /** Looks up the decoded body of @p key, returns false if it isn't cached. */
+    [[nodiscard]] static bool findBody(const void *key, quint8 encoding, QByteArray &body);
+    static void insertBody(const void *key, quint8 encoding, const QByteArray &body);
+
+    /** Looks up the decoded text of @p key, returns false if it isn't cached. */
+    [[nodiscard]] static bool findText(const void *key, quint8 encoding, const QByteArray &charset, QString &text);
+    static void insertText(const void *key, quint8 encoding, const QByteArray &charset, const QString &text);
+
+    /** Drops everything cached for @p key. */
+    static void remove(const void *key);
+};
+
+}
+
+//@endcond
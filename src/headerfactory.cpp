@@ -20,8 +20,10 @@
 
 #include "headerfactory_p.h"
 #include "headers.h"
+#include "headers_p.h"
 
 #include <algorithm>
+#include <typeinfo>
 
 using namespace KMime;
 using namespace KMime::Headers;
@@ -108,14 +110,113 @@ std::unique_ptr<Headers::Base> HeaderFactory::createHeader(QByteArrayView type)
     return {};
 }
 
+#undef mk_header
+
+// Copies the private data of header, which has to be of exactly type T and use TPrivate.
+template <typename T, typename TPrivate>
+static std::unique_ptr<Headers::Base> copyHeader(const Headers::Base *header)
+{
+    auto h = std::make_unique<T>();
+    *static_cast<TPrivate *>(BasePrivate::get(h.get())) = *static_cast<const TPrivate *>(BasePrivate::get(header));
+    return h;
+}
+
+#define mk_copy(hdr, priv) \
+    if (typeid(*header) == typeid(hdr)) \
+        return copyHeader<hdr, priv>(header);
+
 std::unique_ptr<Headers::Base> HeaderFactory::clone(const Headers::Base *header)
 {
-    auto h = createHeader(header->type());
+    // copy the parsed representation of the header types we know the private data of
+    const char *const type = header->type();
+    switch (type ? type[0] : 0) {
+        case 'b':
+        case 'B':
+            mk_copy(Bcc, Generics::AddressListPrivate);
+            break;
+        case 'c':
+        case 'C':
+            mk_copy(Cc, Generics::AddressListPrivate);
+            mk_copy(ContentDescription, Generics::UnstructuredPrivate);
+            mk_copy(ContentDisposition, ContentDispositionPrivate);
+            mk_copy(ContentID, ContentIDPrivate);
+            mk_copy(ContentLocation, Generics::UnstructuredPrivate);
+            mk_copy(ContentTransferEncoding, ContentTransferEncodingPrivate);
+            mk_copy(ContentType, ContentTypePrivate);
+            mk_copy(Control, ControlPrivate);
+            break;
+        case 'd':
+        case 'D':
+            mk_copy(Date, DatePrivate);
+            break;
+        case 'f':
+        case 'F':
+            mk_copy(FollowUpTo, NewsgroupsPrivate);
+            mk_copy(From, Generics::MailboxListPrivate);
+            break;
+        case 'i':
+        case 'I':
+            mk_copy(InReplyTo, Generics::IdentPrivate);
+            break;
+        case 'k':
+        case 'K':
+            mk_copy(Keywords, Generics::PhraseListPrivate);
+            break;
+        case 'l':
+        case 'L':
+            mk_copy(Lines, LinesPrivate);
+            break;
+        case 'm':
+        case 'M':
+            mk_copy(MailCopiesTo, MailCopiesToPrivate);
+            mk_copy(MessageID, Generics::SingleIdentPrivate);
+            mk_copy(MIMEVersion, Generics::DotAtomPrivate);
+            break;
+        case 'n':
+        case 'N':
+            mk_copy(Newsgroups, NewsgroupsPrivate);
+            break;
+        case 'o':
+        case 'O':
+            mk_copy(Organization, Generics::UnstructuredPrivate);
+            break;
+        case 'r':
+        case 'R':
+            mk_copy(References, Generics::IdentPrivate);
+            mk_copy(ReplyTo, Generics::AddressListPrivate);
+            mk_copy(ReturnPath, ReturnPathPrivate);
+            break;
+        case 's':
+        case 'S':
+            mk_copy(Sender, Generics::SingleMailboxPrivate);
+            mk_copy(Subject, Generics::UnstructuredPrivate);
+            mk_copy(Supersedes, Generics::SingleIdentPrivate);
+            break;
+        case 't':
+        case 'T':
+            mk_copy(To, Generics::AddressListPrivate);
+            break;
+        case 'u':
+        case 'U':
+            mk_copy(UserAgent, Generics::UnstructuredPrivate);
+            break;
+    }
+
+    if (typeid(*header) == typeid(Generic)) {
+        // GenericPrivate owns its type, which the constructor copies already
+        auto h = std::make_unique<Generic>(type);
+        *static_cast<Generics::UnstructuredPrivate *>(BasePrivate::get(h.get())) =
+            *static_cast<const Generics::UnstructuredPrivate *>(BasePrivate::get(header));
+        return h;
+    }
+
+    // a header type implemented outside of KMime, go through its string representation
+    auto h = createHeader(type);
     if (!h) {
-        h = std::make_unique<Headers::Generic>(header->type());
+        h = std::make_unique<Headers::Generic>(type);
     }
     h->from7BitString(header->as7BitString());
     return h;
 }
 
-#undef mk_header
+#undef mk_copy
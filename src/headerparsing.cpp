@@ -21,12 +21,16 @@
 
 #include <KCodecs>
 
+#include <QScopeGuard>
 #include <QStringDecoder>
 #include <QUtf8StringView>
 #include <QTimeZone>
 
+#include <algorithm>
 #include <cassert>
 #include <cctype> // for isdigit
+#include <iterator>
+#include <optional>
 
 using namespace KMime;
 using namespace KMime::Types;
@@ -1029,6 +1033,39 @@ static QString stripQuotes(const QString &input)
     }
 }
 
+// Fast path for the by far most common form of addr-spec, plain ASCII dot-atoms
+// on both sides of the '@'. Yields exactly what parseAddrSpec() would, without
+// tokenizing and decoding the input, or fails without consuming any input.
+static bool parseSimpleAddrSpec(const char *&scursor, const char *const send, AddrSpec &result)
+{
+    const char *cursor = scursor;
+    const char *at = nullptr;
+    bool expectAtom = true;
+    for (; cursor != send; ++cursor) {
+        const char ch = *cursor;
+        if (isAText(ch)) {
+            expectAtom = false;
+        } else if (expectAtom) {
+            return false;
+        } else if (ch == '.') {
+            expectAtom = true;
+        } else if (ch == '@' && !at) {
+            at = cursor;
+            expectAtom = true;
+        } else {
+            break;
+        }
+    }
+    // a trailing '.' or 8bit data would still be part of the domain
+    if (!at || expectAtom || (cursor != send && (uchar)*cursor >= 0x80)) {
+        return false;
+    }
+    result.localPart = QString::fromLatin1(QByteArrayView(scursor, at));
+    result.domain = QString::fromLatin1(QByteArrayView(at + 1, cursor));
+    scursor = cursor;
+    return true;
+}
+
 bool parseMailbox(const char *&scursor, const char *const send, Mailbox &result, NewlineType newline)
 {
     ParserState state;
@@ -1047,7 +1084,7 @@ bool parseMailbox(const char *&scursor, const char *const send, Mailbox &result,
 
     // first, try if it's a vanilla addr-spec:
     const char *oldscursor = scursor;
-    if (parseAddrSpec(scursor, send, maybeAddrSpec, newline, state)) {
+    if (parseSimpleAddrSpec(scursor, send, maybeAddrSpec) || parseAddrSpec(scursor, send, maybeAddrSpec, newline, state)) {
         result.setAddress(maybeAddrSpec);
         // check for the obsolete form of display-name (as comment):
         eatWhiteSpace(scursor, send);
@@ -1076,7 +1113,10 @@ bool parseMailbox(const char *&scursor, const char *const send, Mailbox &result,
     }
 
     // third, parse the angle-addr:
-    if (!parseAngleAddr(scursor, send, maybeAddrSpec, newline, state)) {
+    const char *cursor = scursor + 1;
+    if (*scursor == '<' && parseSimpleAddrSpec(cursor, send, maybeAddrSpec) && cursor != send && *cursor == '>') {
+        scursor = cursor + 1;
+    } else if (!parseAngleAddr(scursor, send, maybeAddrSpec, newline, state)) {
         return false;
     }
 
@@ -1251,7 +1291,7 @@ bool parseAddressList(const char *&scursor, const char *const send,
 }
 
 static bool parseParameter(const char *&scursor, const char *const send,
-                           QPair<QByteArray, QStringOrQPair> &result, NewlineType newline, ParserState &state)
+                           QPair<QByteArrayView, QStringOrQPair> &result, NewlineType newline, ParserState &state)
 {
     // parameter = regular-parameter / extended-parameter
     // regular-parameter = regular-parameter-name "=" value
@@ -1259,7 +1299,7 @@ static bool parseParameter(const char *&scursor, const char *const send,
     // value = token / quoted-string
     //
     // note that rfc2231 handling is out of the scope of this function.
-    // Therefore we return the attribute as QByteArray and the value as
+    // Therefore we return the attribute as QByteArrayView and the value as
     // (start,length) tuple if we see that the value is encoded
     // (trailing asterisk), for parseParameterList to decode...
 
@@ -1291,7 +1331,7 @@ static bool parseParameter(const char *&scursor, const char *const send,
                        "Chopping away \"*\".";
             maybeAttribute.chop(1);
         }
-        result = qMakePair(maybeAttribute.toByteArray().toLower(), QStringOrQPair());
+        result = qMakePair(maybeAttribute, QStringOrQPair());
         return true;
     }
 
@@ -1315,28 +1355,36 @@ static bool parseParameter(const char *&scursor, const char *const send,
 
         if (!parseGenericQuotedString(scursor, send, maybeValue.qstring, newline, state)) {
             scursor = oldscursor;
-            result = qMakePair(maybeAttribute.toByteArray().toLower(), QStringOrQPair());
+            result = qMakePair(maybeAttribute, QStringOrQPair());
             return false; // this case needs further processing by upper layers!!
         }
     } else {
         // value is a token:
         if (!parseToken(scursor, send, maybeValue.view, ParseTokenRelaxedTText)) {
             scursor = oldscursor;
-            result = qMakePair(maybeAttribute.toByteArray().toLower(), QStringOrQPair());
+            result = qMakePair(maybeAttribute, QStringOrQPair());
             return false; // this case needs further processing by upper layers!!
         }
     }
 
-    result = qMakePair(maybeAttribute.toByteArray().toLower(), maybeValue);
+    result = qMakePair(maybeAttribute, maybeValue);
     return true;
 }
 
+namespace {
+struct RawParameter {
+    QByteArrayView attribute;
+    QStringOrQPair value;
+};
+using RawParameterList = QVarLengthArray<RawParameter, 8>;
+}
+
 static bool parseRawParameterList(const char *&scursor, const char *const send,
-                                  std::map<QByteArray, QStringOrQPair> &result,
+                                  RawParameterList &result,
                                   NewlineType newline, ParserState &state)
 {
-    // we use parseParameter() consecutively to obtain a map of raw
-    // attributes to raw values. "Raw" here means that we don't do
+    // we use parseParameter() consecutively to obtain a list of raw
+    // attributes and raw values. "Raw" here means that we don't do
     // rfc2231 decoding and concatenation. This is left to
     // parseParameterList(), which will call this function.
     //
@@ -1355,7 +1403,7 @@ static bool parseRawParameterList(const char *&scursor, const char *const send,
             scursor++;
             continue;
         }
-        QPair<QByteArray, QStringOrQPair> maybeParameter;
+        QPair<QByteArrayView, QStringOrQPair> maybeParameter;
         if (!parseParameter(scursor, send, maybeParameter, newline, state)) {
             // we need to do a bit of work if the attribute is not
             // NULL. These are the cases marked with "needs further
@@ -1379,7 +1427,7 @@ static bool parseRawParameterList(const char *&scursor, const char *const send,
             continue;
         }
         // successful parsing brings us here:
-        result[maybeParameter.first] = maybeParameter.second;
+        result.push_back({maybeParameter.first, maybeParameter.second});
 
         eatCFWS(scursor, send, newline);
         // end of header: ends list.
@@ -1394,104 +1442,65 @@ static bool parseRawParameterList(const char *&scursor, const char *const send,
     return true;
 }
 
-static void decodeRFC2231Value(KCodecs::Codec *&rfc2231Codec,
-                               QStringDecoder &textcodec,
-                               bool isContinuation, QString &value,
-                               QByteArrayView &source, QByteArray &charset)
+// Splits charset and language off an rfc2231 extended-initial-value, returns the
+// remaining percent-encoded text, or a null view if there is no charset at all
+static QByteArrayView splitRFC2231InitialValue(QByteArrayView source, QByteArray &charset)
 {
-    //
-    // parse the raw value into (charset,language,text):
-    //
-
-    const char *decBegin = source.data();
-    const char *decCursor = decBegin;
-    const char *decEnd = decCursor + source.size();
-
-    if (!isContinuation) {
-        // find the first single quote
-        while (decCursor != decEnd) {
-            if (*decCursor == '\'') {
-                break;
-            } else {
-                decCursor++;
-            }
-        }
-
-        if (decCursor == decEnd) {
-            // there wasn't a single single quote at all!
-            // take the whole value to be in latin-1:
-            KMIME_WARN << "No charset in extended-initial-value."
-                       "Assuming \"iso-8859-1\".";
-            value += QLatin1StringView(decBegin, source.size());
-            return;
-        }
-
-        charset = QByteArray(decBegin, decCursor - decBegin);
-
-        const char *oldDecCursor = ++decCursor;
-        // find the second single quote (we ignore the language tag):
-        while (decCursor != decEnd) {
-            if (*decCursor == '\'') {
-                break;
-            } else {
-                decCursor++;
-            }
-        }
-        if (decCursor == decEnd) {
-            KMIME_WARN << "No language in extended-initial-value."
-                       "Trying to recover.";
-            decCursor = oldDecCursor;
-        } else {
-            decCursor++;
-        }
-
-        // decCursor now points to the start of the
-        // "extended-other-values":
-
-        //
-        // get the decoders:
-        //
+    // find the first single quote
+    const auto charsetEnd = source.indexOf('\'');
+    if (charsetEnd < 0) {
+        // there wasn't a single single quote at all!
+        KMIME_WARN << "No charset in extended-initial-value."
+                   "Assuming \"iso-8859-1\".";
+        return {};
+    }
+    charset = source.first(charsetEnd).toByteArray();
+
+    // find the second single quote (we ignore the language tag):
+    const auto languageEnd = source.indexOf('\'', charsetEnd + 1);
+    if (languageEnd < 0) {
+        KMIME_WARN << "No language in extended-initial-value."
+                   "Trying to recover.";
+        return source.sliced(charsetEnd + 1);
+    }
+    return source.sliced(languageEnd + 1);
+}
 
-        textcodec = QStringDecoder(charset.constData());
-        if (!textcodec.isValid()) {
-            KMIME_WARN_UNKNOWN(Charset, charset);
-        }
+// Decodes the (concatenated) percent-encoded sections of an rfc2231 value and
+// converts the result from its charset in one go
+static void decodeRFC2231Value(KCodecs::Codec *&rfc2231Codec, QStringDecoder *textcodec,
+                               QByteArrayView source, QString &value)
+{
+    if (!textcodec || !textcodec->isValid()) {
+        value += QLatin1StringView(source);
+        return;
     }
 
     if (!rfc2231Codec) {
         rfc2231Codec = KCodecs::Codec::codecForName("x-kmime-rfc2231");
         assert(rfc2231Codec);
     }
-
-    if (!textcodec.isValid()) {
-        value += QLatin1StringView(decCursor, decEnd - decCursor);
-        return;
-    }
-
-    KCodecs::Decoder *dec = rfc2231Codec->makeDecoder();
+    std::unique_ptr<KCodecs::Decoder> dec(rfc2231Codec->makeDecoder());
     assert(dec);
 
-    //
-    // do the decoding:
-    //
-
     QByteArray buffer;
-    buffer.resize(rfc2231Codec->maxDecodedSizeFor(decEnd - decCursor));
+    buffer.resize(rfc2231Codec->maxDecodedSizeFor(source.size()));
     QByteArray::Iterator bit = buffer.begin();
     QByteArray::ConstIterator bend = buffer.end();
-
-    if (!dec->decode(decCursor, decEnd, bit, bend)) {
+    const char *decCursor = source.begin();
+    if (!dec->decode(decCursor, source.end(), bit, bend)) {
         KMIME_WARN << rfc2231Codec->name()
                    << "codec lies about its maxDecodedSizeFor()"
                    << Qt::endl
                    << "result may be truncated";
     }
 
-    value += textcodec.decode(QByteArrayView(buffer.begin(), bit - buffer.begin()));
+    value += textcodec->decode(QByteArrayView(buffer.begin(), bit - buffer.begin()));
+}
 
-    // qCDebug(KMIME_LOG) << "value now: \"" << value << "\"";
-    // cleanup:
-    delete dec;
+static bool startsWithCaseInsensitive(QByteArrayView data, QByteArrayView prefix)
+{
+    return data.size() >= prefix.size() && data.first(prefix.size()).compare(prefix, Qt::CaseInsensitive) == 0;
 }
 
 // known issues:
@@ -1504,7 +1513,7 @@ bool parseParameterListWithCharset(const char *&scursor,
                                    QByteArray &charset, ParserState &state, NewlineType newline)
 {
     // parse the list into raw attribute-value pairs:
-    std::map<QByteArray, QStringOrQPair> rawParameterList;
+    RawParameterList rawParameterList;
     if (!parseRawParameterList(scursor, send, rawParameterList, newline, state)) {
         return false;
     }
@@ -1513,15 +1522,25 @@ bool parseParameterListWithCharset(const char *&scursor,
         return true;
     }
 
-    // decode rfc 2231 continuations and alternate charset encoding:
+    // sort case-insensitively, so continuations follow their initial section,
+    // and let later duplicates replace earlier ones
+    std::stable_sort(rawParameterList.begin(), rawParameterList.end(), [](const RawParameter &lhs, const RawParameter &rhs) {
+        return lhs.attribute.compare(rhs.attribute, Qt::CaseInsensitive) < 0;
+    });
+    const auto firstUnique = std::unique(rawParameterList.rbegin(), rawParameterList.rend(), [](const RawParameter &lhs, const RawParameter &rhs) {
+        return lhs.attribute.compare(rhs.attribute, Qt::CaseInsensitive) == 0;
+    });
+    rawParameterList.erase(rawParameterList.begin(), firstUnique.base());
 
-    // Note this code assumes that what QMapIterator delivers is sorted
-    // by the key!
+    // decode rfc 2231 continuations and alternate charset encoding:
 
     KCodecs::Codec *rfc2231Codec = nullptr;
-    QStringDecoder textcodec;
-    QByteArray attribute;
+    // decoder for the charset of the current rfc2231 value, see cachedDecoder() for its lifetime
+    QStringDecoder *textcodec = nullptr;
+    QByteArrayView attribute;
     QString value;
+    // the percent-encoded sections of the current rfc2231 value, decoded all at once
+    QByteArray encoded;
     enum Mode {
         NoMode = 0x0, Continued = 0x1, Encoded = 0x2
     };
@@ -1532,19 +1551,28 @@ bool parseParameterListWithCharset(const char *&scursor,
         RFC2231
     };
 
-    for (auto &it : rawParameterList) {
-        if (attribute.isNull() || !it.first.startsWith(attribute)) {
+    const auto flushEncoded = [&]() {
+        if (!encoded.isEmpty()) {
+            decodeRFC2231Value(rfc2231Codec, textcodec, encoded, value);
+            encoded.truncate(0);
+        }
+    };
+
+    for (const auto &it : rawParameterList) {
+        if (attribute.isNull() || !startsWithCaseInsensitive(it.attribute, attribute)) {
             //
             // new attribute:
             //
 
             // store the last attribute/value pair in the result map now:
             if (!attribute.isNull()) {
-                result[attribute] = value;
+                flushEncoded();
+                result.insert(attribute, value);
             }
             // and extract the information from the new raw attribute:
             value.clear();
-            attribute = it.first;
+            textcodec = nullptr;
+            attribute = it.attribute;
             int mode = NoMode;
             EncodingMode encodingMode = NoEncoding;
 
@@ -1555,13 +1583,13 @@ bool parseParameterListWithCharset(const char *&scursor,
                 encodingMode = RFC2231;
             }
             // is the value rfc2047-encoded?
-            if (!it.second.qstring.isNull() &&
-                it.second.qstring.contains(QLatin1StringView("=?"))) {
+            if (!it.value.qstring.isNull() &&
+                it.value.qstring.contains(QLatin1StringView("=?"))) {
               mode |= Encoded;
               encodingMode = RFC2047;
             }
             // is the value continued?
-            if (attribute.endsWith(QLatin1StringView("*0"))) {
+            if (attribute.endsWith("*0")) {
               attribute.chop(2);
               mode |= Continued;
             }
@@ -1570,18 +1598,32 @@ bool parseParameterListWithCharset(const char *&scursor,
             //
             if (mode & Encoded) {
                 if (encodingMode == RFC2231) {
-                    decodeRFC2231Value(rfc2231Codec, textcodec,
-                                       false, /* isn't continuation */
-                                       value, it.second.view, charset);
+                    const auto text = splitRFC2231InitialValue(it.value.view, charset);
+                    if (text.isNull()) {
+                        // take the whole value to be in latin-1:
+                        value += QLatin1StringView(it.value.view);
+                    } else {
+                        textcodec = &cachedDecoder(charset);
+                        if (!textcodec->isValid()) {
+                            KMIME_WARN_UNKNOWN(Charset, charset);
+                        }
+                        encoded += text;
+                    }
                 } else if (encodingMode == RFC2047) {
-                    value += KCodecs::decodeRFC2047String(it.second.qstring.toLatin1(), &charset);
+                    value += KCodecs::decodeRFC2047String(it.value.qstring.toLatin1(), &charset);
                 }
+            } else if (!(mode & Continued) && !it.value.view.isNull() && isUsAscii(it.value.view)) {
+                // not encoded and complete, by far the most common case:
+                // store the raw value directly, it's valid UTF-8 already
+                result.insert(attribute, it.value.view.toByteArray());
+                attribute = {};
+                continue;
             } else {
                 // not encoded.
-                if (!it.second.view.isNull()) {
-                    value += QLatin1StringView(it.second.view);
+                if (!it.value.view.isNull()) {
+                    value += QLatin1StringView(it.value.view);
                 } else {
-                    value += it.second.qstring;
+                    value += it.value.qstring;
                 }
             }
 
@@ -1591,43 +1633,49 @@ bool parseParameterListWithCharset(const char *&scursor,
 
             if (!(mode & Continued)) {
                 // save result already:
-                result[attribute] = value;
+                flushEncoded();
+                result.insert(attribute, value);
                 // force begin of a new attribute:
-                attribute.clear();
+                attribute = {};
             }
-        } else { // it.key().startsWith( attribute )
+        } else { // it.attribute.startsWith(attribute)
             //
             // continuation
             //
 
-            // ignore the section and trust QMap to have sorted the keys:
-            if (it.first.endsWith('*')) {
-                // encoded
-                decodeRFC2231Value(rfc2231Codec, textcodec,
-                                   true, /* is continuation */
-                                   value, it.second.view, charset);
+            // ignore the section and trust the sorting above:
+            if (it.attribute.endsWith('*')) {
+                // encoded, collected to be decoded together with the other sections
+                encoded += it.value.view;
             } else {
                 // not encoded
-                if (!it.second.view.isNull()) {
-                    value += QLatin1StringView(it.second.view);
+                flushEncoded();
+                if (!it.value.view.isNull()) {
+                    value += QLatin1StringView(it.value.view);
                 } else {
-                    value += it.second.qstring;
+                    value += it.value.qstring;
                 }
             }
         }
     }
     // write last attr/value pair:
     if (!attribute.isNull()) {
-        result[attribute] = value;
+        flushEncoded();
+        result.insert(attribute, value);
     }
 
     return true;
 }
 
-static const char stdDayNames[][4] = {
-    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+// day and month names are looked up by their lower-cased three letters packed into an integer
+static constexpr quint32 nameKey(const char name[3])
+{
+    return (quint32(uchar(name[0]) | 0x20) << 16) | (quint32(uchar(name[1]) | 0x20) << 8) | quint32(uchar(name[2]) | 0x20);
+}
+
+static constexpr const quint32 stdDayNames[] = {
+    nameKey("sun"), nameKey("mon"), nameKey("tue"), nameKey("wed"), nameKey("thu"), nameKey("fri"), nameKey("sat")
 };
-static const int stdDayNamesLen = sizeof stdDayNames / sizeof *stdDayNames;
 
 static bool parseDayName(const char *&scursor, const char *const send)
 {
@@ -1636,10 +1684,10 @@ static bool parseDayName(const char *&scursor, const char *const send)
         return false;
     }
 
-    for (int i = 0 ; i < stdDayNamesLen ; ++i) {
-        if (qstrnicmp(scursor, stdDayNames[i], 3) == 0) {
+    const auto key = nameKey(scursor);
+    for (const auto dayName : stdDayNames) {
+        if (key == dayName) {
             scursor += 3;
-            // qCDebug(KMIME_LOG) << "found" << stdDayNames[i];
             return true;
         }
     }
@@ -1647,12 +1695,11 @@ static bool parseDayName(const char *&scursor, const char *const send)
     return false;
 }
 
-static const char stdMonthNames[][4] = {
-    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
-    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+static constexpr const quint32 stdMonthNames[] = {
+    nameKey("jan"), nameKey("feb"), nameKey("mar"), nameKey("apr"), nameKey("may"), nameKey("jun"),
+    nameKey("jul"), nameKey("aug"), nameKey("sep"), nameKey("oct"), nameKey("nov"), nameKey("dec")
 };
-static const int stdMonthNamesLen =
-    sizeof stdMonthNames / sizeof *stdMonthNames;
+static constexpr const int stdMonthNamesLen = std::size(stdMonthNames);
 
 static bool parseMonthName(const char *&scursor, const char *const send,
                            int &result)
@@ -1662,8 +1709,9 @@ static bool parseMonthName(const char *&scursor, const char *const send,
         return false;
     }
 
+    const auto key = nameKey(scursor);
     for (result = 0 ; result < stdMonthNamesLen ; ++result) {
-        if (qstrnicmp(scursor, stdMonthNames[result], 3) == 0) {
+        if (key == stdMonthNames[result]) {
             scursor += 3;
             return true;
         }
@@ -1673,6 +1721,31 @@ static bool parseMonthName(const char *&scursor, const char *const send,
     return false;
 }
 
+static constexpr bool isLeapYear(int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static constexpr int daysInMonth(int year, int month)
+{
+    constexpr const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+// days since 1970-01-01 of the given (valid, proleptic Gregorian) date
+static constexpr qint64 daysSinceEpoch(qint64 year, int month, int day)
+{
+    // shift the year to start in March, so the leap day is at its end
+    year -= month <= 2 ? 1 : 0;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const qint64 yearOfEra = year - era * 400;
+    const qint64 dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+static_assert(daysSinceEpoch(1970, 1, 1) == 0);
+static_assert(daysSinceEpoch(2000, 3, 1) == 11017);
+
 static const struct {
     const char tzName[5];
     int secsEastOfGMT;
@@ -1919,7 +1992,7 @@ bool parseQDateTime(const char *&scursor, const char *const send,
 }
 
 bool parseDateTime(const char *&scursor, const char *const send,
-                   QDateTime &result, NewlineType newline)
+                   qint64 &secsSinceEpoch, int &offsetFromUtc, NewlineType newline)
 {
     // Parsing date-time; strict mode:
     //
@@ -1931,7 +2004,8 @@ bool parseDateTime(const char *&scursor, const char *const send,
     // month-name  := "Jan" / "Feb" / "Mar" / "Apr" / "May" / "Jun" /
     //                "Jul" / "Aug" / "Sep" / "Oct" / "Nov" / "Dec"
 
-    result = QDateTime();
+    secsSinceEpoch = 0;
+    offsetFromUtc = 0;
 
     eatCFWS(scursor, send, newline);
     if (scursor == send) {
@@ -2013,12 +2087,10 @@ bool parseDateTime(const char *&scursor, const char *const send,
     }
 
     eatCFWS(scursor, send, newline);
-    int maybeHour;
-    int maybeMinute;
-    int maybeSecond;
+    int maybeHour = 0;
+    int maybeMinute = 0;
+    int maybeSecond = 0;
     long int secsEastOfGMT = 0;
-    QDate maybeDate;
-    QTime maybeTime;
     if (scursor != send) {
         //
         // time
@@ -2054,78 +2126,83 @@ bool parseDateTime(const char *&scursor, const char *const send,
             return false; // rfc2822, 3.3
         }
 
-        maybeDate = QDate(maybeYear, maybeMonth, maybeDay);
-        maybeTime = QTime(maybeHour, maybeMinute, maybeSecond);
-
-        if (!maybeDate.isValid() || !maybeTime.isValid()) {
+        if (maybeHour > 23 || maybeMinute > 59 || maybeSecond > 59) {
             return false;
         }
-    } else {
-        maybeDate = QDate(maybeYear, maybeMonth, maybeDay);
-        maybeTime = QTime(0, 0, 0);
     }
 
-    result = QDateTime(maybeDate, maybeTime, QTimeZone::fromSecondsAheadOfUtc(secsEastOfGMT));
-    if (!result.isValid()) {
+    // the same limits QDate/QDateTime/QTimeZone have
+    if (maybeYear <= 0 || maybeYear > 292278993 || maybeDay < 1 || maybeDay > daysInMonth(maybeYear, maybeMonth)) {
+        return false;
+    }
+    if (secsEastOfGMT < QTimeZone::MinUtcOffsetSecs || secsEastOfGMT > QTimeZone::MaxUtcOffsetSecs) {
         return false;
     }
+
+    secsSinceEpoch = daysSinceEpoch(maybeYear, maybeMonth, maybeDay) * 86400
+                   + maybeHour * 3600 + maybeMinute * 60 + maybeSecond - secsEastOfGMT;
+    offsetFromUtc = int(secsEastOfGMT);
     return true;
 }
 
-namespace {
-
-std::unique_ptr<Headers::Base> extractHeader(QByteArrayView head, const qsizetype headerStart, qsizetype &endOfFieldBody)
+bool parseDateTime(const char *&scursor, const char *const send,
+                   QDateTime &result, NewlineType newline)
 {
-    std::unique_ptr<Headers::Base> header;
-
-    auto startOfFieldBody = head.indexOf(':', headerStart);
-    if (startOfFieldBody <= 0) {
-        return nullptr;
+    qint64 secsSinceEpoch = 0;
+    int offsetFromUtc = 0;
+    if (!parseDateTime(scursor, send, secsSinceEpoch, offsetFromUtc, newline)) {
+        result = QDateTime();
+        return false;
     }
+    result = QDateTime::fromSecsSinceEpoch(secsSinceEpoch, QTimeZone::fromSecondsAheadOfUtc(offsetFromUtc));
+    return result.isValid();
+}
 
-    const char *rawType = head.constData() + headerStart;
-    const size_t rawTypeLen = startOfFieldBody - headerStart;
-
-    startOfFieldBody++; //skip the ':'
-    if (startOfFieldBody < head.size() - 1 &&  head[startOfFieldBody] == ' ') { // skip the space after the ':', if there's any
-        startOfFieldBody++;
+void tokenizeHeaders(QByteArrayView head, QList<HeaderField> &fields)
+{
+    fields.clear();
+    qsizetype cursor = 0;
+    HeaderField field;
+    while (nextHeaderField(head, cursor, field)) {
+        fields.push_back(field);
     }
+}
+
+namespace {
 
-    bool folded = false;
-    endOfFieldBody = findHeaderLineEnd(head, startOfFieldBody, &folded);
+std::unique_ptr<Headers::Base> createHeader(const HeaderField &field, QByteArray &unfoldBuffer)
+{
+    std::unique_ptr<Headers::Base> header;
 
     // We might get an invalid mail without a field name, don't crash on that.
-    if (rawTypeLen > 0) {
-        header = HeaderFactory::createHeader(QByteArrayView(rawType, rawTypeLen));
+    if (!field.name.isEmpty()) {
+        header = HeaderFactory::createHeader(field.name);
     }
     if (!header) {
-        const char* typeData = rawType;
-        int typeLen = rawTypeLen;
+        QByteArrayView type = field.name;
         QByteArray cleanedType;
 
-        // Check for null bytes in rawType
-        if (memchr(rawType, '\0', rawTypeLen)) {
-            cleanedType = QByteArray(rawType, rawTypeLen);
+        // Check for null bytes in the field name
+        if (type.contains('\0')) {
+            cleanedType = type.toByteArray();
             cleanedType.replace('\0', "");
+            type = cleanedType;
 
-            typeData = cleanedType.constData();
-            typeLen = cleanedType.size();
-
-            if (typeLen > 0) {
-                header = HeaderFactory::createHeader(QByteArrayView(typeData, typeLen));
+            if (!type.isEmpty()) {
+                header = HeaderFactory::createHeader(type);
             }
         }
 
         if (!header) {
-            //qCWarning(KMIME_LOG)() << "Returning Generic header of type" << QByteArrayView(typeData, typeLen);
-            header = std::make_unique<Headers::Generic>(typeData, typeLen);
+            //qCWarning(KMIME_LOG)() << "Returning Generic header of type" << type;
+            header = std::make_unique<Headers::Generic>(type.constData(), type.size());
         }
     }
-    if (folded) {
-        const auto unfoldedBody = unfoldHeader(head.constData() + startOfFieldBody, endOfFieldBody - startOfFieldBody);
-        header->from7BitString(unfoldedBody);
+    if (field.folded) {
+        unfoldHeader(field.body.constData(), field.body.size(), unfoldBuffer);
+        header->from7BitString(unfoldBuffer);
     } else {
-        header->from7BitString(QByteArrayView(head.constData() + startOfFieldBody, endOfFieldBody - startOfFieldBody));
+        header->from7BitString(field.body);
     }
 
     return header;
@@ -2135,14 +2212,16 @@ std::unique_ptr<Headers::Base> extractHeader(QByteArrayView head, const qsizetyp
 
 std::unique_ptr<KMime::Headers::Base> parseNextHeader(QByteArrayView &head)
 {
-    qsizetype endOfFieldBody = 0;
-    std::unique_ptr<KMime::Headers::Base> header(extractHeader(head, 0, endOfFieldBody));
-    if (header) {
-        head = head.mid(endOfFieldBody + 1);
-    } else {
+    qsizetype cursor = 0;
+    HeaderField field;
+    if (!nextHeaderField(head, cursor, field)) {
         head = {};
+        return nullptr;
     }
 
+    QByteArray unfolded;
+    auto header = createHeader(field, unfolded);
+    head = head.mid(cursor);
     return header;
 }
 
@@ -2169,20 +2248,90 @@ void extractHeaderAndBody(const QByteArray &content, QByteArray &header, QByteAr
     }
 }
 
-QList<Headers::Base *> parseHeaders(const QByteArray &head) {
-    QList<Headers::Base *> ret;
+void extractAddresses(QByteArrayView head, AddressFields fields,
+                      const std::function<void(AddressField field, QByteArrayView addrSpec)> &sink)
+{
+    struct FieldName {
+        AddressField field;
+        QByteArrayView name;
+    };
+    static constexpr const FieldName fieldNames[] = {
+        { AddressField::From, "From" },
+        { AddressField::Sender, "Sender" },
+        { AddressField::ReplyTo, "Reply-To" },
+        { AddressField::To, "To" },
+        { AddressField::Cc, "Cc" },
+        { AddressField::Bcc, "Bcc" },
+    };
+
+    // scratch buffers, kept around to not reallocate them for every message;
+    // a call from within sink gets its own, as the outer call still uses them
+    struct Scratch {
+        QByteArray unfolded;
+        QList<Address> addresses;
+        QByteArray lowered;
+    };
+    thread_local Scratch threadScratch;
+    thread_local int depth = 0;
+    std::optional<Scratch> nestedScratch;
+    if (depth > 0) {
+        nestedScratch.emplace();
+    }
+    auto &[unfolded, addresses, lowered] = nestedScratch ? *nestedScratch : threadScratch;
+    ++depth;
+    const auto leave = qScopeGuard([] {
+        --depth;
+    });
 
     qsizetype cursor = 0;
-    while (cursor < head.size()) {
-        const auto headerStart = cursor;
-        qsizetype endOfFieldBody;
-        if (auto header = extractHeader(head, headerStart, endOfFieldBody)) {
-            ret << header.release();
-            cursor = endOfFieldBody + 1;
-        } else {
-            break;
+    HeaderField field;
+    while (cursor < head.size() && head[cursor] != '\n' && nextHeaderField(head, cursor, field)) {
+        const auto it = std::find_if(std::begin(fieldNames), std::end(fieldNames), [&field](const FieldName &fieldName) {
+            return field.name.compare(fieldName.name, Qt::CaseInsensitive) == 0;
+        });
+        if (it == std::end(fieldNames) || !fields.testFlag(it->field)) {
+            continue;
+        }
+
+        QByteArrayView body = field.body;
+        if (field.folded) {
+            unfoldHeader(body.constData(), body.size(), unfolded);
+            body = unfolded;
+        }
+        addresses.clear();
+        const char *scursor = body.constData();
+        if (!parseAddressList(scursor, scursor + body.size(), addresses)) {
+            continue;
+        }
+        for (const auto &address : std::as_const(addresses)) {
+            for (const auto &mailbox : address.mailboxList) {
+                if (!mailbox.hasAddress()) {
+                    continue;
+                }
+                const auto addrSpec = mailbox.address();
+                lowered.resize(addrSpec.size());
+                std::transform(addrSpec.begin(), addrSpec.end(), lowered.begin(), [](char c) {
+                    return (c >= 'A' && c <= 'Z') ? char(c + 'a' - 'A') : c;
+                });
+                sink(it->field, lowered);
+            }
         }
     }
+}
+
+QList<Headers::Base *> parseHeaders(const QByteArray &head) {
+    // scratch buffers, kept around to not reallocate them for every message
+    thread_local QList<HeaderField> fields;
+    thread_local QByteArray unfolded;
+
+    tokenizeHeaders(head, fields);
+
+    QList<Headers::Base *> ret;
+    ret.reserve(fields.size());
+    for (const auto &field : std::as_const(fields)) {
+        ret << createHeader(field, unfolded).release();
+    }
+    fields.clear();
 
     return ret;
 }
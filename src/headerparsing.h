@@ -16,6 +16,8 @@
 
 #include <QStringList>
 
+#include <functional>
+
 namespace KMime
 {
 
@@ -166,6 +168,56 @@ KMIME_EXPORT bool parseMailbox(const char *&scursor, const char *const send,
 KMIME_EXPORT void extractHeaderAndBody(const QByteArray &content,
                                        QByteArray &header, QByteArray &body);
 
+/*!
+ * Address header fields for extractAddresses().
+ *
+ * \value From The "From" header
+ * \value Sender The "Sender" header
+ * \value ReplyTo The "Reply-To" header
+ * \value To The "To" header
+ * \value Cc The "Cc" header
+ * \value Bcc The "Bcc" header
+ *
+ * \since 26.08
+ */
+enum class AddressField {
+    From = 0x01,
+    Sender = 0x02,
+    ReplyTo = 0x04,
+    To = 0x08,
+    Cc = 0x10,
+    Bcc = 0x20,
+};
+Q_DECLARE_FLAGS(AddressFields, AddressField)
+
+/*!
+ * Extracts the addresses of all mailboxes in the header fields selected by
+ * \a fields from the raw message header \a head, without creating any
+ * header objects or parsing the fields that are not selected. The selected
+ * fields are parsed into temporary Types::Address lists.
+ *
+ * \a head is the raw, LF separated message header as returned by
+ * Content::head(). Parsing stops at the first empty line, so this can also
+ * be passed an entire message.
+ *
+ * For every mailbox with an address, \a sink is called with the field it was
+ * found in and its addr-spec in lower case, as Types::Mailbox::address() would
+ * return it. The addr-spec view is only valid during the call. Mailboxes in
+ * groups are reported individually, fields that fail to parse are skipped
+ * entirely, like the corresponding header classes do.
+ *
+ * This is meant for scanning large numbers of messages: the parsing buffers
+ * are kept per thread and reused across calls. It is safe to call from
+ * multiple threads concurrently, and \a sink may call extractAddresses()
+ * again.
+ *
+ * \since 26.08
+ */
+KMIME_EXPORT void extractAddresses(QByteArrayView head, AddressFields fields,
+                                   const std::function<void(AddressField field, QByteArrayView addrSpec)> &sink);
+
 } // namespace HeaderParsing
 
 } // namespace KMime
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KMime::HeaderParsing::AddressFields)
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "headers_p.h"
+#include "util_p.h"
 
 #include <QList>
 
@@ -44,6 +45,12 @@ struct ParserState {
 
 [[nodiscard]] QList<KMime::Headers::Base *> parseHeaders(const QByteArray &head);
 
+/**
+  Splits the header block @p head into its fields in a single pass.
+  @param fields is cleared before being filled, so it can be reused
+*/
+void tokenizeHeaders(QByteArrayView head, QList<HeaderField> &fields);
+
 enum ParseTokenFlag {
     ParseTokenNoFlag = 0,
     ParseTokenAllow8Bit = 1,
@@ -160,6 +167,16 @@ void eatCFWS(const char *&scursor, const char *const send, NewlineType newline,
           int &sec, long int &secsEastOfGMT, bool &timeZoneKnown,
           NewlineType newline = NewlineType::LF);
 
+/**
+  Parses an RFC 5322 date-time without creating a QDateTime.
+  @param scursor pointer to the first character of the input string
+  @param send pointer to end of input buffer
+  @param secsSinceEpoch the parsed point in time as seconds since the epoch (UTC)
+  @param offsetFromUtc the offset from UTC the date-time was specified in, in seconds
+*/
+[[nodiscard]] bool parseDateTime(const char *&scursor, const char *const send,
+                                qint64 &secsSinceEpoch, int &offsetFromUtc,
+                                NewlineType newline = NewlineType::LF);
 [[nodiscard]] bool parseDateTime(const char *&scursor, const char *const send,
                                 QDateTime &result, NewlineType newline = NewlineType::LF);
 [[nodiscard]] bool parseQDateTime(const char *&scursor, const char *const send,
@@ -37,6 +37,9 @@
 
 #include <KCodecs>
 
+#include <QTimeZone>
+
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 
@@ -129,6 +132,69 @@ bool Base::is(QByteArrayView t) const
 
 //-----</Base>---------------------------------
 
+//-----<ParameterMap>--------------------------
+
+static bool parameterNameLess(const ParameterMap::Parameter &param, QByteArrayView name)
+{
+    return QByteArrayView(param.name).compare(name, Qt::CaseInsensitive) < 0;
+}
+
+// lower-cased copy of @p name, sharing the data of the most common parameter names
+static QByteArray parameterName(QByteArrayView name)
+{
+    static const QByteArray commonNames[] = {
+        QByteArrayLiteral("boundary"),
+        QByteArrayLiteral("charset"),
+        QByteArrayLiteral("creation-date"),
+        QByteArrayLiteral("delsp"),
+        QByteArrayLiteral("filename"),
+        QByteArrayLiteral("format"),
+        QByteArrayLiteral("id"),
+        QByteArrayLiteral("micalg"),
+        QByteArrayLiteral("modification-date"),
+        QByteArrayLiteral("name"),
+        QByteArrayLiteral("number"),
+        QByteArrayLiteral("protocol"),
+        QByteArrayLiteral("read-date"),
+        QByteArrayLiteral("size"),
+        QByteArrayLiteral("total"),
+        QByteArrayLiteral("type"),
+    };
+    for (const auto &commonName : commonNames) {
+        if (QByteArrayView(commonName).compare(name, Qt::CaseInsensitive) == 0) {
+            return commonName;
+        }
+    }
+    return name.toByteArray().toLower();
+}
+
+ParameterMap::const_iterator ParameterMap::find(QByteArrayView name) const
+{
+    const auto it = std::lower_bound(begin(), end(), name, parameterNameLess);
+    if (it != end() && QByteArrayView(it->name).compare(name, Qt::CaseInsensitive) == 0) {
+        return it;
+    }
+    return end();
+}
+
+QString ParameterMap::value(QByteArrayView name) const
+{
+    const auto it = find(name);
+    return it != end() ? QString::fromUtf8(it->value) : QString();
+}
+
+void ParameterMap::insert(QByteArrayView name, QByteArray value)
+{
+    const auto it = std::lower_bound(m_parameters.begin(), m_parameters.end(), name, parameterNameLess);
+    if (it != m_parameters.end() && QByteArrayView(it->name).compare(name, Qt::CaseInsensitive) == 0) {
+        it->value = std::move(value);
+        return;
+    }
+    m_parameters.insert(it, Parameter{parameterName(name), std::move(value)});
+}
+
+//-----</ParameterMap>-------------------------
+
 namespace Generics
 {
 
@@ -777,20 +843,20 @@ QByteArray Parametrized::as7BitString() const
 
     QByteArray rv;
     bool first = true;
-    for (const auto &it : d->parameterHash) {
+    for (const auto &param : d->parameterHash) {
         if (!first) {
             rv += "; ";
         } else {
             first = false;
         }
-        if (isUsAscii(it.second)) {
-            rv += it.first + '=';
-            QByteArray tmp = it.second.toLatin1();
+        if (isUsAscii(param.value)) {
+            rv += param.name + '=';
+            QByteArray tmp = param.value;
             addQuotes(tmp, true);   // force quoting, e.g. for whitespaces in parameter value
             rv += tmp;
         } else {
-            rv += it.first + "*=";
-            rv += encodeRFC2231String(it.second, rfc2047Charset());
+            rv += param.name + "*=";
+            rv += encodeRFC2231String(QString::fromUtf8(param.value), rfc2047Charset());
         }
     }
 
@@ -799,9 +865,7 @@ QByteArray Parametrized::as7BitString() const
 
 QString Parametrized::parameter(QByteArrayView key) const
 {
-    Q_D(const Parametrized);
-    const auto it = d->parameterHash.find(key);
-    return it != d->parameterHash.end() ? (*it).second : QString();
+    return d_func()->parameterHash.value(key);
 }
 
 bool Parametrized::hasParameter(QByteArrayView key) const
@@ -812,7 +876,7 @@ bool Parametrized::hasParameter(QByteArrayView key) const
 void Parametrized::setParameter(const QByteArray &key, const QString &value)
 {
     Q_D(Parametrized);
-    d->parameterHash[key] = value;
+    d->parameterHash.insert(key, value);
 }
 
 bool Parametrized::isEmpty() const
@@ -838,6 +902,62 @@ bool Parametrized::parse(const char  *&scursor, const char *const send,
 
 //-----<Ident>-------------------------
 
+// Parses the msg-id at scursor and appends it (without angle brackets)
+// to result, normalized the same way as AddrSpec::asString().
+static bool parseMsgId(const char *&scursor, const char *const send, QByteArray &result,
+                       NewlineType newline, ParserState &state)
+{
+    // fast path for the by far most common case of plain ASCII dot-atoms on both
+    // sides of the '@', which need neither unquoting nor normalization
+    if (scursor != send && *scursor == '<') {
+        const char *cursor = scursor + 1;
+        bool sawAt = false;
+        bool expectAtom = true;
+        for (; cursor != send; ++cursor) {
+            const char ch = *cursor;
+            if (isAText(ch)) {
+                expectAtom = false;
+            } else if (expectAtom) {
+                break;
+            } else if (ch == '.') {
+                expectAtom = true;
+            } else if (ch == '@' && !sawAt) {
+                sawAt = true;
+                expectAtom = true;
+            } else {
+                break;
+            }
+        }
+        if (cursor != send && *cursor == '>' && sawAt && !expectAtom) {
+            result.append(scursor + 1, cursor - scursor - 1);
+            scursor = cursor + 1;
+            return true;
+        }
+    }
+
+    AddrSpec maybeMsgId;
+    if (!parseAngleAddr(scursor, send, maybeMsgId, newline, state)) {
+        return false;
+    }
+    result += maybeMsgId.asString().toLatin1();
+    return true;
+}
+
+// Same as parseMsgId(), but for user input that might lack the angle brackets
+static bool parseMsgId(const QByteArray &id, QByteArray &result)
+{
+    QByteArray tmp = id;
+    if (!tmp.startsWith('<')) {
+        tmp.prepend('<');
+    }
+    if (!tmp.endsWith('>')) {
+        tmp.append('>');
+    }
+    const char *cursor = tmp.constData();
+    ParserState state;
+    return parseMsgId(cursor, cursor + tmp.length(), result, NewlineType::LF, state);
+}
+
 //@cond PRIVATE
 kmime_mk_trivial_ctor_with_dptr(Ident, Structured)
 kmime_mk_dptr_ctor(Ident, Structured)
@@ -846,18 +966,16 @@ kmime_mk_dptr_ctor(Ident, Structured)
 QByteArray Ident::as7BitString() const
 {
     const Q_D(Ident);
-    if (d->msgIdList.isEmpty()) {
+    if (d->msgIdEnds.isEmpty()) {
       return {};
     }
 
     QByteArray rv;
-    for (const Types::AddrSpec &addr : std::as_const(d->msgIdList)) {
-        if (!addr.isEmpty()) {
-            const QString asString = addr.asString();
+    rv.reserve(d->msgIds.size() + 3 * d->msgIdEnds.size());
+    for (qsizetype i = 0; i < d->msgIdEnds.size(); ++i) {
+        if (const auto msgId = d->msgId(i); !msgId.isEmpty()) {
             rv += '<';
-            if (!asString.isEmpty()) {
-                rv += asString.toLatin1(); // FIXME: change parsing to use QByteArrays
-            }
+            rv += msgId;
             rv += "> ";
         }
     }
@@ -869,7 +987,7 @@ QByteArray Ident::as7BitString() const
 
 bool Ident::isEmpty() const
 {
-    return d_func()->msgIdList.isEmpty();
+    return d_func()->msgIdEnds.isEmpty();
 }
 
 bool Ident::parse(const char *&scursor, const char *const send, NewlineType newline)
@@ -882,7 +1000,8 @@ bool Ident::parse(const char *&scursor, const char *const send, NewlineType newl
     // equivalent to:
     // msg-id   := angle-addr
 
-    d->msgIdList.clear();
+    d->msgIds.clear();
+    d->msgIdEnds.clear();
 
     ParserState state;
     while (scursor != send) {
@@ -897,11 +1016,10 @@ bool Ident::parse(const char *&scursor, const char *const send, NewlineType newl
             continue;
         }
 
-        AddrSpec maybeMsgId;
-        if (!parseAngleAddr(scursor, send, maybeMsgId, newline, state)) {
+        if (!parseMsgId(scursor, send, d->msgIds, newline, state)) {
             return false;
         }
-        d->msgIdList.append(maybeMsgId);
+        d->msgIdEnds.append(d->msgIds.size());
 
         eatCFWS(scursor, send, newline, state);
         // header end ending the list: OK.
@@ -917,14 +1035,24 @@ bool Ident::parse(const char *&scursor, const char *const send, NewlineType newl
 }
 
 QList<QByteArray> Ident::identifiers() const {
+    const Q_D(Ident);
     QList<QByteArray> rv;
-    const auto msgIdList = d_func()->msgIdList;
-    for (const Types::AddrSpec &addr : msgIdList) {
-        if (!addr.isEmpty()) {
-            const QString asString = addr.asString();
-            if (!asString.isEmpty()) {
-                rv.append(asString.toLatin1());   // FIXME: change parsing to use QByteArrays
-            }
+    rv.reserve(d->msgIdEnds.size());
+    for (qsizetype i = 0; i < d->msgIdEnds.size(); ++i) {
+        if (const auto msgId = d->msgId(i); !msgId.isEmpty()) {
+            rv.append(msgId.toByteArray());
+        }
+    }
+    return rv;
+}
+
+QList<QByteArrayView> Ident::identifiersView() const {
+    const Q_D(Ident);
+    QList<QByteArrayView> rv;
+    rv.reserve(d->msgIdEnds.size());
+    for (qsizetype i = 0; i < d->msgIdEnds.size(); ++i) {
+        if (const auto msgId = d->msgId(i); !msgId.isEmpty()) {
+            rv.append(msgId);
         }
     }
     return rv;
@@ -933,24 +1061,15 @@ QList<QByteArray> Ident::identifiers() const {
 void Ident::fromIdent(const Ident &ident)
 {
     d_func()->encCS = ident.d_func()->encCS;
-    d_func()->msgIdList = ident.d_func()->msgIdList;
+    d_func()->msgIds = ident.d_func()->msgIds;
+    d_func()->msgIdEnds = ident.d_func()->msgIdEnds;
 }
 
 void Ident::appendIdentifier(const QByteArray &id)
 {
     Q_D(Ident);
-    QByteArray tmp = id;
-    if (!tmp.startsWith('<')) {
-        tmp.prepend('<');
-    }
-    if (!tmp.endsWith('>')) {
-        tmp.append('>');
-    }
-    AddrSpec msgId;
-    const char *cursor = tmp.constData();
-    ParserState state;
-    if (parseAngleAddr(cursor, cursor + tmp.length(), msgId, NewlineType::LF, state)) {
-        d->msgIdList.append(msgId);
+    if (parseMsgId(id, d->msgIds)) {
+        d->msgIdEnds.append(d->msgIds.size());
     } else {
         qCWarning(KMIME_LOG) << "Unable to parse address spec!";
     }
@@ -972,14 +1091,7 @@ QByteArray SingleIdent::as7BitString() const
       return {};
     }
 
-    QByteArray rv;
-    const QString asString = d->msgId.asString();
-    rv += '<';
-    if (!asString.isEmpty()) {
-        rv += asString.toLatin1(); // FIXME: change parsing to use QByteArrays
-    }
-    rv += '>';
-    return rv;
+    return '<' + d->msgId + '>';
 }
 
 bool SingleIdent::isEmpty() const
@@ -991,36 +1103,16 @@ bool SingleIdent::isEmpty() const
 QByteArray SingleIdent::identifier() const
 {
     Q_D(const SingleIdent);
-    if (d->msgId.isEmpty()) {
-        return {};
-    }
-    if (d->cachedIdentifier.isEmpty()) {
-        const QString asString = d->msgId.asString();
-        if (!asString.isEmpty()) {
-            d->cachedIdentifier = asString.toLatin1();// FIXME: change parsing to use QByteArrays
-        }
-    }
-
-    return d->cachedIdentifier;
+    return d->msgId;
 }
 
 void SingleIdent::setIdentifier(const QByteArray &id)
 {
     Q_D(SingleIdent);
-    d->msgId = {};
-    d->cachedIdentifier.clear();
+    d->msgId.clear();
 
-    QByteArray tmp = id;
-    if (!tmp.startsWith('<')) {
-        tmp.prepend('<');
-    }
-    if (!tmp.endsWith('>')) {
-        tmp.append('>');
-    }
-    AddrSpec msgId;
-    const char *cursor = tmp.constData();
-    ParserState state;
-    if (parseAngleAddr(cursor, cursor + tmp.length(), msgId, NewlineType::LF, state)) {
+    QByteArray msgId;
+    if (parseMsgId(id, msgId)) {
         d->msgId = msgId;
     } else {
         qCWarning(KMIME_LOG) << "Unable to parse address spec!";
@@ -1031,12 +1123,12 @@ bool SingleIdent::parse(const char *&scursor, const char *const send, NewlineTyp
 {
     Q_D(SingleIdent);
 
-    d->msgId = {};
-    d->cachedIdentifier.clear();
+    d->msgId.clear();
 
-    AddrSpec maybeMsgId;
+    QByteArray maybeMsgId;
     ParserState state;
-    if (!parseAngleAddr(scursor, send, maybeMsgId, newline, state)) {
+    eatCFWS(scursor, send, newline, state);
+    if (!parseMsgId(scursor, send, maybeMsgId, newline, state)) {
         return false;
     }
     eatCFWS(scursor, send, newline);
@@ -1354,31 +1446,54 @@ QByteArray Date::as7BitString() const
 
     //QT5 fix port to QDateTime Qt::RFC2822Date is not enough we need to fix it. We need to use QLocale("C") + add "ddd, ";
     //rv += d_func()->dateTime.toString(  Qt::RFC2822Date ).toLatin1();
-    return QLocale::c().toString(d_func()->dateTime, QStringLiteral("ddd, ")).toLatin1()
-         + d_func()->dateTime.toString(Qt::RFC2822Date).toLatin1();
+    const auto dt = dateTime();
+    return QLocale::c().toString(dt, QStringLiteral("ddd, ")).toLatin1()
+         + dt.toString(Qt::RFC2822Date).toLatin1();
 }
 
 bool Date::isEmpty() const {
-    return d_func()->dateTime.isNull() || !d_func()->dateTime.isValid();
+    return !d_func()->valid;
 }
 
 QDateTime Date::dateTime() const {
-    return d_func()->dateTime;
+    const Q_D(Date);
+    if (!d->valid) {
+        return {};
+    }
+    if (d->dateTime.isValid()) {
+        return d->dateTime;
+    }
+    return QDateTime::fromSecsSinceEpoch(d->secsSinceEpoch, QTimeZone::fromSecondsAheadOfUtc(d->offsetFromUtc));
+}
+
+qint64 Date::secsSinceEpoch() const {
+    return d_func()->secsSinceEpoch;
+}
+
+int Date::offsetFromUtc() const {
+    return d_func()->offsetFromUtc;
 }
 
 void Date::setDateTime(const QDateTime & dt) {
     Q_D(Date);
+    d->valid = dt.isValid();
     d->dateTime = dt;
+    d->secsSinceEpoch = d->valid ? dt.toSecsSinceEpoch() : 0;
+    d->offsetFromUtc = d->valid ? dt.offsetFromUtc() : 0;
 }
 
 bool Date::parse(const char *&scursor, const char *const send, NewlineType newline) {
     Q_D(Date);
     const char *start = scursor;
-    bool result = parseDateTime(scursor, send, d->dateTime, newline);
-    if (!result) {
-        result = parseQDateTime(start, send, d->dateTime, newline);
+    d->dateTime = QDateTime();
+    d->valid = parseDateTime(scursor, send, d->secsSinceEpoch, d->offsetFromUtc, newline);
+    if (!d->valid) {
+        QDateTime dt;
+        if (parseQDateTime(start, send, dt, newline)) {
+            setDateTime(dt);
+        }
     }
-    return result;
+    return d->valid;
 }
 
 //-----</Date>---------------------------------
@@ -1512,6 +1627,37 @@ kmime_mk_trivial_ctor_with_name_and_dptr(ContentType, Generics::Parametrized,
             Content-Type)
 //@endcond
 
+void ContentTypePrivate::setMimeType(const QByteArray &type)
+{
+    mimeType = type;
+    slashPos = mimeType.indexOf('/');
+    if (mimeType.isEmpty()) {
+        classification = TextClass | PlainTextClass;
+        return;
+    }
+
+    const QByteArrayView media = slashPos < 0 ? QByteArrayView(mimeType) : QByteArrayView(mimeType).first(slashPos);
+    const QByteArrayView sub = slashPos < 0 ? QByteArrayView() : QByteArrayView(mimeType).sliced(slashPos + 1);
+    const auto equals = [](QByteArrayView lhs, const char *rhs) {
+        return lhs.compare(rhs, Qt::CaseInsensitive) == 0;
+    };
+    classification = 0;
+    if (equals(media, "text")) {
+        classification |= TextClass;
+        if (equals(sub, "plain")) {
+            classification |= PlainTextClass;
+        } else if (equals(sub, "html")) {
+            classification |= HtmlTextClass;
+        }
+    } else if (equals(media, "image")) {
+        classification |= ImageClass;
+    } else if (equals(media, "multipart")) {
+        classification |= MultipartClass;
+    } else if (equals(media, "message") && equals(sub, "partial")) {
+        classification |= PartialClass;
+    }
+}
+
 bool ContentType::isEmpty() const {
     return d_func()->mimeType.isEmpty();
 }
@@ -1537,45 +1683,40 @@ QByteArray ContentType::mimeType() const {
 
 QByteArray ContentType::mediaType() const {
     Q_D(const ContentType);
-    const auto pos = d->mimeType.indexOf('/');
-    if (pos < 0) {
+    if (d->slashPos < 0) {
         return d->mimeType;
     } else {
-        return d->mimeType.left(pos);
+        return d->mimeType.left(d->slashPos);
     }
 }
 
 QByteArray ContentType::subType() const {
     Q_D(const ContentType);
-    const auto pos = d->mimeType.indexOf('/');
-    if (pos < 0) {
+    if (d->slashPos < 0) {
       return {};
     } else {
-        return d->mimeType.mid(pos + 1);
+        return d->mimeType.mid(d->slashPos + 1);
     }
 }
 
 void ContentType::setMimeType(const QByteArray & mimeType) {
     Q_D(ContentType);
-    d->mimeType = mimeType;
+    d->setMimeType(mimeType);
 }
 
 bool ContentType::isMediatype(const char *mediatype) const {
     Q_D(const ContentType);
-    const auto len = (qsizetype)strlen(mediatype);
-    return qstrnicmp(d->mimeType.constData(), mediatype, len) == 0 &&
-            (d->mimeType.at(len) == '/' || d->mimeType.size() == len);
+    const QByteArrayView mimeType(d->mimeType);
+    const auto media = d->slashPos < 0 ? mimeType : mimeType.first(d->slashPos);
+    return media.compare(mediatype, Qt::CaseInsensitive) == 0;
 }
 
 bool ContentType::isSubtype(const char *subtype) const {
     Q_D(const ContentType);
-    const auto pos = d->mimeType.indexOf('/');
-    if (pos < 0) {
+    if (d->slashPos < 0) {
         return false;
     }
-    const auto len = (qsizetype)strlen(subtype);
-    return qstrnicmp(d->mimeType.constData() + pos + 1, subtype, len) == 0 &&
-            d->mimeType.size() == pos + len + 1;
+    return QByteArrayView(d->mimeType).sliced(d->slashPos + 1).compare(subtype, Qt::CaseInsensitive) == 0;
 }
 
 bool ContentType::isMimeType(const char* mimeType) const
@@ -1585,27 +1726,27 @@ bool ContentType::isMimeType(const char* mimeType) const
 }
 
 bool ContentType::isText() const {
-    return (isMediatype("text") || isEmpty());
+    return d_func()->classification & ContentTypePrivate::TextClass;
 }
 
 bool ContentType::isPlainText() const {
-    return (qstricmp(d_func()->mimeType.constData(), "text/plain") == 0 || isEmpty());
+    return d_func()->classification & ContentTypePrivate::PlainTextClass;
 }
 
 bool ContentType::isHTMLText() const {
-    return qstricmp(d_func()->mimeType.constData(), "text/html") == 0;
+    return d_func()->classification & ContentTypePrivate::HtmlTextClass;
 }
 
 bool ContentType::isImage() const {
-    return isMediatype("image");
+    return d_func()->classification & ContentTypePrivate::ImageClass;
 }
 
 bool ContentType::isMultipart() const {
-    return isMediatype("multipart");
+    return d_func()->classification & ContentTypePrivate::MultipartClass;
 }
 
 bool ContentType::isPartial() const {
-    return qstricmp(d_func()->mimeType.constData(), "message/partial") == 0;
+    return d_func()->classification & ContentTypePrivate::PartialClass;
 }
 
 QByteArray ContentType::charset() const {
@@ -1678,7 +1819,7 @@ bool ContentType::parse(const char *&scursor, const char *const send,
                         NewlineType newline) {
     Q_D(ContentType);
     // content-type: type "/" subtype *(";" parameter)
-    d->mimeType.clear();
+    d->setMimeType({});
     d->parameterHash.clear();
     eatCFWS(scursor, send, newline);
     if (scursor == send) {
@@ -1705,11 +1846,12 @@ bool ContentType::parse(const char *&scursor, const char *const send,
         return false;
     }
 
-    d->mimeType.reserve(maybeMimeType.size() + maybeSubType.size() + 1);
-    d->mimeType.append(maybeMimeType);
-    d->mimeType.append('/');
-    d->mimeType.append(maybeSubType);
-    d->mimeType = std::move(d->mimeType).toLower();
+    QByteArray mimeType;
+    mimeType.reserve(maybeMimeType.size() + maybeSubType.size() + 1);
+    mimeType.append(maybeMimeType);
+    mimeType.append('/');
+    mimeType.append(maybeSubType);
+    d->setMimeType(std::move(mimeType).toLower());
 
     // parameter list
     eatCFWS(scursor, send, newline);
@@ -1743,8 +1885,7 @@ bool ContentID::parse(const char *&scursor, const char *const send, NewlineType
     const char *origscursor = scursor;
     if (!SingleIdent::parse(scursor, send, newline)) {
         scursor = origscursor;
-        d->msgId = {};
-        d->cachedIdentifier.clear();
+        d->msgId.clear();
 
         while (scursor != send) {
             eatCFWS(scursor, send, newline);
@@ -1758,7 +1899,6 @@ bool ContentID::parse(const char *&scursor, const char *const send, NewlineType
                 continue;
             }
 
-            AddrSpec maybeContentId;
             // Almost parseAngleAddr
             if (scursor == send || *scursor != '<') {
                 return false;
@@ -1783,8 +1923,7 @@ bool ContentID::parse(const char *&scursor, const char *const send, NewlineType
             scursor++;
             // /Almost parseAngleAddr
 
-            maybeContentId.localPart = QString::fromLatin1(result); // FIXME: just use QByteArray instead of AddrSpec in msgIdList?
-            d->msgId = maybeContentId;
+            d->msgId = result.toByteArray();
 
             eatCFWS(scursor, send, newline);
             // header end ending the list: OK.
@@ -536,6 +536,17 @@ public:
     */
     [[nodiscard]] QList<QByteArray> identifiers() const;
 
+    /*!
+      Returns the list of identifiers contained in this header, like
+      identifiers() does, but without copying them.
+
+      The returned views point into this header and are only valid as long
+      as it is neither modified nor destroyed.
+
+      \since 26.08
+    */
+    [[nodiscard]] QList<QByteArrayView> identifiersView() const;
+
     /*!
       Appends a new identifier to this header.
 
@@ -1422,9 +1433,29 @@ public:
 
     /*!
       Returns the date contained in this header.
+
+      A date set by setDateTime() is returned unchanged, including its
+      milliseconds and time zone. A parsed date is returned with the offset
+      from UTC it was specified in.
     */
     [[nodiscard]] QDateTime dateTime() const;
 
+    /*!
+      Returns the date contained in this header as seconds since the epoch (UTC),
+      without constructing a QDateTime. Returns 0 if the header is empty.
+
+      \since 26.08
+    */
+    [[nodiscard]] qint64 secsSinceEpoch() const;
+
+    /*!
+      Returns the offset from UTC in seconds the date in this header was
+      specified in. Returns 0 if the header is empty.
+
+      \since 26.08
+    */
+    [[nodiscard]] int offsetFromUtc() const;
+
     /*!
       Sets the date.
     */
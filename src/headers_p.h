@@ -12,8 +12,7 @@
 #include <QByteArray>
 #include <QList>
 #include <QString>
-
-#include <map>
+#include <QVarLengthArray>
 
 //@cond PRIVATE
 
@@ -23,18 +22,37 @@ namespace KMime
 namespace Headers
 {
 
-// case-insensitive QByteArray comparator supporting heterogenous lookup
-// between QByteArray and QByteArrayView
-struct CaseInsitiveByteArrayLess {
-    using is_transparent = bool;
-    template <typename T1, typename T2>
-    bool operator()(T1 &&lhs, T2 &&rhs) const
-    {
-        return QByteArrayView(lhs).compare(rhs, Qt::CaseInsensitive) < 0;
-    }
-};
+// Parameters of a Parametrized header, as a flat vector sorted by the lower-cased
+// parameter names. Parameter lists are short (usually one to three entries), so
+// a few of them are stored inline, and values are kept as UTF-8 encoded bytes.
+class ParameterMap
+{
+public:
+    struct Parameter {
+        QByteArray name; // lower-case
+        QByteArray value; // UTF-8
+    };
+    using const_iterator = const Parameter *;
+
+    [[nodiscard]] const_iterator begin() const { return m_parameters.cbegin(); }
+    [[nodiscard]] const_iterator end() const { return m_parameters.cend(); }
+    [[nodiscard]] bool empty() const { return m_parameters.isEmpty(); }
+    [[nodiscard]] qsizetype size() const { return m_parameters.size(); }
+    void clear() { m_parameters.clear(); }
+
+    /** Case-insensitive lookup of the parameter @p name, end() if not found. */
+    [[nodiscard]] const_iterator find(QByteArrayView name) const;
+    [[nodiscard]] bool contains(QByteArrayView name) const { return find(name) != end(); }
+    /** Returns the decoded value of parameter @p name, a null string if not found. */
+    [[nodiscard]] QString value(QByteArrayView name) const;
 
-using ParameterMap = std::map<QByteArray, QString, CaseInsitiveByteArrayLess>;
+    /** Sets parameter @p name to the UTF-8 encoded @p value, replacing any previous value. */
+    void insert(QByteArrayView name, QByteArray value);
+    void insert(QByteArrayView name, const QString &value) { insert(name, value.toUtf8()); }
+
+private:
+    QVarLengthArray<Parameter, 2> m_parameters;
+};
 
 // Note that this entire class hierarchy has no virtual dtor, in order to not
 // have a second set of vtables, as this is a rather high-volume class.
@@ -44,6 +62,16 @@ using ParameterMap = std::map<QByteArray, QString, CaseInsitiveByteArrayLess>;
 class BasePrivate
 {
 public:
+    /** Returns the private data of @p header, e.g. for copying it into another header. */
+    [[nodiscard]] static const BasePrivate *get(const Base *header)
+    {
+        return header->d_ptr;
+    }
+    [[nodiscard]] static BasePrivate *get(Base *header)
+    {
+        return header->d_ptr;
+    }
+
     QByteArray encCS;
 };
 
@@ -78,14 +106,23 @@ public:
 class IdentPrivate : public StructuredPrivate
 {
 public:
-    QList<KMime::Types::AddrSpec> msgIdList;
+    [[nodiscard]] inline QByteArrayView msgId(qsizetype i) const
+    {
+        const auto begin = i > 0 ? msgIdEnds[i - 1] : 0;
+        return QByteArrayView(msgIds).sliced(begin, msgIdEnds[i] - begin);
+    }
+
+    // all msg-ids (without angle brackets) concatenated
+    QByteArray msgIds;
+    // end offsets of the individual msg-ids in msgIds
+    QList<qsizetype> msgIdEnds;
 };
 
 class SingleIdentPrivate : public StructuredPrivate
 {
 public:
-    KMime::Types::AddrSpec msgId;
-    mutable QByteArray cachedIdentifier;
+    // without angle brackets
+    QByteArray msgId;
 };
 
 class TokenPrivate : public StructuredPrivate
@@ -136,7 +173,22 @@ public:
 class ContentTypePrivate : public Generics::ParametrizedPrivate
 {
 public:
+    // classification of mimeType, computed once whenever it changes
+    enum Class : quint8 {
+        TextClass = 0x01, // also set for an empty mimeType
+        PlainTextClass = 0x02, // also set for an empty mimeType
+        HtmlTextClass = 0x04,
+        ImageClass = 0x08,
+        MultipartClass = 0x10,
+        PartialClass = 0x20,
+    };
+
+    /** Sets the mimeType and updates the classification. */
+    void setMimeType(const QByteArray &type);
+
     QByteArray mimeType;
+    int slashPos = -1; // position of the '/' in mimeType, or -1
+    quint8 classification = TextClass | PlainTextClass;
 };
 
 class ContentDispositionPrivate : public Generics::ParametrizedPrivate
@@ -166,7 +218,12 @@ public:
 class DatePrivate : public Generics::StructuredPrivate
 {
 public:
+    // a date set by setDateTime(), returned as is by dateTime()
     QDateTime dateTime;
+    // parsed dates are kept as plain numbers, the QDateTime is only created on demand
+    qint64 secsSinceEpoch = 0;
+    qint32 offsetFromUtc = 0;
+    bool valid = false;
 };
 
 class NewsgroupsPrivate : public Generics::StructuredPrivate
@@ -57,25 +57,25 @@ const Content *Message::mainBodyPart(const QByteArray &type) const
         }
 
         // empty multipart
-        if (c->contents().empty()) {
+        const auto children = ContentPrivate::children(c);
+        if (children.isEmpty()) {
             return nullptr;
         }
 
         // multipart/alternative
-        if (contentType && contentType->subType() == "alternative") {
+        if (contentType && contentType->isSubtype("alternative")) {
             if (type.isEmpty()) {
-                return c->contents()[0];
+                return children[0];
             }
-            const auto contents = c->contents();
-            for  (auto c1 : contents) {
-                if (c1->contentType()->mimeType() == type) {
+            for (const Content *c1 : children) {
+                if (const auto ct = c1->contentType(); ct && ct->mimeType() == type) {
                     return c1;
                 }
             }
             return nullptr;
         }
 
-        c = c->contents()[0];
+        c = children[0];
     }
 
     return nullptr;
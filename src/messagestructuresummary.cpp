@@ -0,0 +1,184 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "messagestructuresummary.h"
+#include "content_p.h"
+#include "message.h"
+#include "util.h"
+
+#include <QDataStream>
+#include <QSharedData>
+#include <QVarLengthArray>
+
+using namespace KMime;
+
+// version of the serialization format, to be increased on every change of it
+static constexpr quint8 SerializationVersion = 1;
+
+class MessageStructureSummary::Private : public QSharedData
+{
+public:
+    ContentIndex mainTextPartIndex;
+    qint64 decodedSize = 0;
+    int partCount = 0;
+    int attachmentCount = 0;
+    Flags flags = NoFlags;
+    bool valid = false;
+};
+
+MessageStructureSummary::MessageStructureSummary() : d(new Private)
+{
+}
+
+MessageStructureSummary::MessageStructureSummary(const Message *message) : d(new Private)
+{
+    if (!message) {
+        return;
+    }
+    d->valid = true;
+
+    const Content *mainTextPart = nullptr;
+    const PartRoles wanted = PartRole::Body | PartRole::Attachment | PartRole::Invitation | PartRole::Signed | PartRole::Encrypted;
+    classifyParts(message, wanted, [this, message, &mainTextPart](const Content *c, PartRoles roles) {
+        if (roles.testFlag(PartRole::Body)) {
+            mainTextPart = c;
+        }
+        if (roles.testFlag(PartRole::Attachment)) {
+            d->flags |= HasAttachment;
+            if (c != message) { // like Content::attachments()
+                ++d->attachmentCount;
+            }
+        }
+        if (roles.testFlag(PartRole::Invitation)) {
+            d->flags |= HasInvitation;
+        }
+        if (roles.testFlag(PartRole::Signed)) {
+            d->flags |= Signed;
+        }
+        if (roles.testFlag(PartRole::Encrypted)) {
+            d->flags |= Encrypted;
+        }
+        if (const auto ct = c->contentType(); !ct || !ct->isMultipart()) {
+            ++d->partCount;
+            d->decodedSize += ContentPrivate::decodedBodySize(c);
+        }
+        return true;
+    });
+    if (mainTextPart) {
+        d->mainTextPartIndex = message->indexForContent(mainTextPart);
+    }
+}
+
+MessageStructureSummary::MessageStructureSummary(const MessageStructureSummary &other) = default;
+MessageStructureSummary::MessageStructureSummary(MessageStructureSummary &&) noexcept = default;
+
+MessageStructureSummary::~MessageStructureSummary() = default;
+
+MessageStructureSummary &MessageStructureSummary::operator=(const MessageStructureSummary &other) = default;
+MessageStructureSummary &MessageStructureSummary::operator=(MessageStructureSummary &&) noexcept = default;
+
+bool MessageStructureSummary::isValid() const
+{
+    return d->valid;
+}
+
+MessageStructureSummary::Flags MessageStructureSummary::flags() const
+{
+    return d->flags;
+}
+
+int MessageStructureSummary::partCount() const
+{
+    return d->partCount;
+}
+
+int MessageStructureSummary::attachmentCount() const
+{
+    return d->attachmentCount;
+}
+
+ContentIndex MessageStructureSummary::mainTextPartIndex() const
+{
+    return d->mainTextPartIndex;
+}
+
+qint64 MessageStructureSummary::decodedSize() const
+{
+    return d->decodedSize;
+}
+
+bool MessageStructureSummary::operator==(const MessageStructureSummary &other) const
+{
+    return d->valid == other.d->valid
+        && d->flags == other.d->flags
+        && d->partCount == other.d->partCount
+        && d->attachmentCount == other.d->attachmentCount
+        && d->decodedSize == other.d->decodedSize
+        && d->mainTextPartIndex == other.d->mainTextPartIndex;
+}
+
+bool MessageStructureSummary::operator!=(const MessageStructureSummary &other) const
+{
+    return !(*this == other);
+}
+
+QDataStream &KMime::operator<<(QDataStream &stream, const MessageStructureSummary &summary)
+{
+    const auto &d = summary.d;
+    stream << SerializationVersion << d->valid << static_cast<quint32>(d->flags.toInt())
+           << static_cast<qint32>(d->partCount) << static_cast<qint32>(d->attachmentCount)
+           << d->decodedSize;
+
+    // the part numbers of the main text part index, top-most first
+    stream << static_cast<quint32>(d->mainTextPartIndex.size());
+    for (qsizetype level = 0; level < d->mainTextPartIndex.size(); ++level) {
+        stream << static_cast<quint32>(d->mainTextPartIndex.at(level));
+    }
+    return stream;
+}
+
+QDataStream &KMime::operator>>(QDataStream &stream, MessageStructureSummary &summary)
+{
+    summary = MessageStructureSummary();
+
+    quint8 version = 0;
+    stream >> version;
+    if (version != SerializationVersion) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return stream;
+    }
+
+    bool valid = false;
+    quint32 flags = 0;
+    qint32 partCount = 0;
+    qint32 attachmentCount = 0;
+    qint64 decodedSize = 0;
+    quint32 levels = 0;
+    stream >> valid >> flags >> partCount >> attachmentCount >> decodedSize >> levels;
+
+    QVarLengthArray<quint32, 8> index;
+    for (quint32 level = 0; level < levels && stream.status() == QDataStream::Ok; ++level) {
+        quint32 part = 0;
+        stream >> part;
+        index.append(part);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        return stream;
+    }
+
+    auto &d = summary.d;
+    d->valid = valid;
+    d->flags = MessageStructureSummary::Flags::fromInt(flags);
+    d->partCount = partCount;
+    d->attachmentCount = attachmentCount;
+    d->decodedSize = decodedSize;
+    // push() adds the top-most part number, so start with the bottom-most one
+    for (auto it = index.crbegin(); it != index.crend(); ++it) {
+        d->mainTextPartIndex.push(*it);
+    }
+    return stream;
+}
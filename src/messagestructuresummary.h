@@ -0,0 +1,153 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+#include "contentindex.h"
+
+#include <QFlags>
+#include <QMetaType>
+#include <QSharedDataPointer>
+
+class QDataStream;
+
+namespace KMime
+{
+
+class Message;
+
+/*!
+  \class KMime::MessageStructureSummary
+  \inmodule KMime
+  \inheaderfile KMime/MessageStructureSummary
+
+  \brief A compact summary of the MIME structure of a Message.
+
+  The summary answers the questions KMime::hasAttachment(), KMime::isSigned(),
+  KMime::isEncrypted(), KMime::hasInvitation() and Message::textContent()
+  answer for a message, determined in a single walk over the message.
+  It does not reference the message it was created from, and can be
+  serialized with QDataStream, so that it can be stored next to an index
+  of messages and be used without parsing the message again.
+
+  The summary is not updated when the message is modified.
+
+  This class is implicitly shared.
+
+  \since 26.08
+*/
+class KMIME_EXPORT MessageStructureSummary
+{
+public:
+    /*!
+      \value NoFlags
+      \value HasAttachment The message has an attachment, see KMime::hasAttachment().
+      \value Signed The message is partly or fully signed, see KMime::isSigned().
+      \value Encrypted The message is partly or fully encrypted, see KMime::isEncrypted().
+      \value HasInvitation The message contains an invitation, see KMime::hasInvitation().
+    */
+    enum Flag {
+        NoFlags = 0x00,
+        HasAttachment = 0x01,
+        Signed = 0x02,
+        Encrypted = 0x04,
+        HasInvitation = 0x08,
+    };
+    Q_DECLARE_FLAGS(Flags, Flag)
+
+    /*!
+      Creates an invalid summary.
+    */
+    MessageStructureSummary();
+
+    /*!
+      Creates the summary of \a message.
+    */
+    explicit MessageStructureSummary(const Message *message);
+
+    MessageStructureSummary(const MessageStructureSummary &other);
+    MessageStructureSummary(MessageStructureSummary &&) noexcept;
+
+    ~MessageStructureSummary();
+
+    MessageStructureSummary &operator=(const MessageStructureSummary &other);
+    MessageStructureSummary &operator=(MessageStructureSummary &&) noexcept;
+
+    /*!
+      Returns \c true if this summary was created from a message.
+    */
+    [[nodiscard]] bool isValid() const;
+
+    /*!
+      Returns the flags describing the message.
+    */
+    [[nodiscard]] Flags flags() const;
+
+    /*!
+      Returns the number of parts of the message, that is the number of
+      Contents which are not multipart Contents. Encapsulated messages
+      count as a single part.
+    */
+    [[nodiscard]] int partCount() const;
+
+    /*!
+      Returns the number of attachments of the message, see Content::attachments().
+    */
+    [[nodiscard]] int attachmentCount() const;
+
+    /*!
+      Returns the index of the main text part of the message, see
+      Content::textContent().
+
+      The index is invalid if there is no text part, or if the message
+      is not a multipart message and thus is the text part itself.
+    */
+    [[nodiscard]] ContentIndex mainTextPartIndex() const;
+
+    /*!
+      Returns the sum of the decoded sizes of all parts, in bytes.
+
+      This is the sum of the sizes of Content::decodedBody() of the parts,
+      determined without decoding base64 and quoted-printable encoded parts.
+      An encapsulated message counts with the size of its encoded content,
+      as Content::decodedBody() is empty for it.
+    */
+    [[nodiscard]] qint64 decodedSize() const;
+
+    [[nodiscard]] bool operator==(const MessageStructureSummary &other) const;
+    [[nodiscard]] bool operator!=(const MessageStructureSummary &other) const;
+
+private:
+    friend KMIME_EXPORT QDataStream &operator<<(QDataStream &stream, const MessageStructureSummary &summary);
+    friend KMIME_EXPORT QDataStream &operator>>(QDataStream &stream, MessageStructureSummary &summary);
+
+    class Private;
+    QSharedDataPointer<Private> d;
+};
+
+/*!
+  \relates KMime::MessageStructureSummary
+
+  Writes \a summary to \a stream.
+*/
+KMIME_EXPORT QDataStream &operator<<(QDataStream &stream, const MessageStructureSummary &summary);
+
+/*!
+  \relates KMime::MessageStructureSummary
+
+  Reads a summary from \a stream into \a summary. Data written by an
+  unknown version of KMime sets the status of \a stream to
+  QDataStream::ReadCorruptData and results in an invalid summary.
+*/
+KMIME_EXPORT QDataStream &operator>>(QDataStream &stream, MessageStructureSummary &summary);
+
+} // namespace KMime
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KMime::MessageStructureSummary::Flags)
+Q_DECLARE_METATYPE(KMime::MessageStructureSummary)
+Q_DECLARE_TYPEINFO(KMime::MessageStructureSummary, Q_RELOCATABLE_TYPE);
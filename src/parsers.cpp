@@ -139,6 +139,8 @@ bool UUEncoded::parse()
     qsizetype currentPos = 0;
     bool success = true;
     bool firstIteration = true;
+    // the head is only tokenized once, however many blocks need to look at it
+    const KMime::RawHeaderIndex headers(m_head);
 
     while (success) {
         qsizetype beginPos = currentPos;
@@ -201,9 +203,9 @@ bool UUEncoded::parse()
                 break; //too many "non-M-Lines" found, we give up
             }
 
-            const auto subject = KMime::extractHeader(m_head, "Subject");
-            if ((!containsBegin || !containsEnd) && !subject.isNull()) {
+            if ((!containsBegin || !containsEnd) && headers.contains("Subject")) {
                 // message may be split up => parse subject
+                const auto subject = headers.value("Subject");
                 const QRegularExpression subjectRegex(QStringLiteral("[0-9]+/[0-9]+"));
                 const auto match = subjectRegex.match(QLatin1StringView(subject));
                 pos = match.capturedStart(0);
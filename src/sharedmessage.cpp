@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "sharedmessage.h"
+#include "content_p.h"
+#include "message.h"
+
+using namespace KMime;
+
+// Returns the tree to hand out to another handle or to a caller of message().
+// A detached tree may still be modified through the pointer returned by
+// detach(), so it is never shared, a clone of it is handed out instead.
+static std::shared_ptr<Message> shareable(const std::shared_ptr<Message> &message, bool detached)
+{
+    if (!message || !detached) {
+        return message;
+    }
+    return ContentPrivate::clone(message.get());
+}
+
+SharedMessage::SharedMessage() = default;
+
+SharedMessage::SharedMessage(std::unique_ptr<Message> &&message)
+    : m_message(std::move(message))
+{
+}
+
+SharedMessage::SharedMessage(const SharedMessage &other)
+    : m_message(shareable(other.m_message, other.m_detached))
+{
+}
+
+SharedMessage::SharedMessage(SharedMessage &&) noexcept = default;
+
+SharedMessage::~SharedMessage() = default;
+
+SharedMessage &SharedMessage::operator=(const SharedMessage &other)
+{
+    if (this != &other) {
+        m_message = shareable(other.m_message, other.m_detached);
+        m_detached = false;
+    }
+    return *this;
+}
+
+SharedMessage &SharedMessage::operator=(SharedMessage &&) noexcept = default;
+
+bool SharedMessage::isNull() const
+{
+    return !m_message;
+}
+
+const Message *SharedMessage::get() const
+{
+    return m_message.get();
+}
+
+const Message *SharedMessage::operator->() const
+{
+    return m_message.get();
+}
+
+const Message &SharedMessage::operator*() const
+{
+    return *m_message;
+}
+
+std::shared_ptr<const Message> SharedMessage::message() const
+{
+    return shareable(m_message, m_detached);
+}
+
+Message *SharedMessage::detach()
+{
+    if (!m_message) {
+        return nullptr;
+    }
+
+    if (m_message.use_count() > 1) {
+        m_message = ContentPrivate::clone(m_message.get());
+    }
+    m_detached = true;
+    return m_message.get();
+}
@@ -0,0 +1,116 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+
+#include <QMetaType>
+
+#include <memory>
+
+namespace KMime
+{
+
+class Message;
+
+/*!
+  \class KMime::SharedMessage
+  \inmodule KMime
+  \inheaderfile KMime/SharedMessage
+
+  \brief An implicitly shared, read-only handle to a parsed Message.
+
+  Copies of a SharedMessage share the same message tree. The const
+  methods of its Content and header objects don't modify it, and the
+  encoded body cache they fill is guarded by a lock, so the tree can be
+  read from several threads at the same time.
+
+  To modify the message, call detach(). It clones the message tree
+  first if any other handle (or a pointer obtained by message()) still
+  references it, so the other handles keep seeing the unmodified message.
+  From then on the handle keeps its tree to itself: copies of it and
+  message() get a clone of the message as it is at that point, so the
+  pointer returned by detach() only ever modifies a tree nobody else reads.
+  To share the modified message cheaply again, copy the detached handle
+  once and hand out copies of that copy.
+
+  \code
+  KMime::SharedMessage shared(std::move(parsedMessage));
+  // hand copies of shared to reader threads, then later:
+  auto msg = shared.detach();
+  msg->subject()->fromUnicodeString(u"Re: "_s + msg->subject()->asUnicodeString());
+  \endcode
+
+  Like other implicitly shared classes, SharedMessage itself is reentrant:
+  the shared message can be read from several threads, but each thread
+  needs its own copy of the handle.
+
+  \note Content::bodyAsMessage() hands out non-const encapsulated
+  messages, those must not be modified while the tree is shared either.
+
+  \since 26.08
+*/
+class KMIME_EXPORT SharedMessage
+{
+public:
+    /*!
+      Creates a null handle.
+    */
+    SharedMessage();
+
+    /*!
+      Creates a handle taking ownership of \a message.
+    */
+    explicit SharedMessage(std::unique_ptr<Message> &&message);
+
+    SharedMessage(const SharedMessage &other);
+    SharedMessage(SharedMessage &&) noexcept;
+
+    ~SharedMessage();
+
+    SharedMessage &operator=(const SharedMessage &other);
+    SharedMessage &operator=(SharedMessage &&) noexcept;
+
+    /*!
+      Returns \c true if this handle does not reference a message.
+    */
+    [[nodiscard]] bool isNull() const;
+
+    /*!
+      Returns the shared message, or \nullptr for a null handle.
+    */
+    [[nodiscard]] const Message *get() const;
+    [[nodiscard]] const Message *operator->() const;
+    [[nodiscard]] const Message &operator*() const;
+
+    /*!
+      Returns the shared message, keeping it alive independent of
+      this handle. For a detached handle, this is a clone of its message.
+    */
+    [[nodiscard]] std::shared_ptr<const Message> message() const;
+
+    /*!
+      Returns a modifiable message, cloning the shared one first unless
+      this handle is the only reference to it. The result stays owned by
+      this handle, and remains valid and modifiable as long as the handle
+      isn't assigned to or destroyed. Copies made from this handle
+      afterwards don't see later modifications.
+
+      Returns \nullptr for a null handle.
+    */
+    [[nodiscard]] Message *detach();
+
+private:
+    std::shared_ptr<Message> m_message;
+    // whether detach() handed out m_message for modification
+    bool m_detached = false;
+};
+
+} // namespace KMime
+
+Q_DECLARE_METATYPE(KMime::SharedMessage)
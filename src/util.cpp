@@ -12,12 +12,14 @@
 #include "util_p.h"
 
 #include "charfreq_p.h"
+#include "content_p.h"
 #include "message.h"
 
 #include <QCoreApplication>
 #include <QUuid>
 
 #include <algorithm>
+#include <span>
 
 using namespace KMime;
 
@@ -171,35 +173,33 @@ bool isCryptoPart(const Content *content)
         return false;
     }
 
-    const QByteArray lowerSubType = ct->subType().toLower();
-    if (lowerSubType == "pgp-encrypted" ||
-        lowerSubType == "pgp-signature" ||
-        lowerSubType == "pkcs7-mime" ||
-        lowerSubType == "x-pkcs7-mime" ||
-        lowerSubType == "pkcs7-signature" ||
-        lowerSubType == "x-pkcs7-signature") {
+    if (ct->isSubtype("pgp-encrypted") ||
+        ct->isSubtype("pgp-signature") ||
+        ct->isSubtype("pkcs7-mime") ||
+        ct->isSubtype("x-pkcs7-mime") ||
+        ct->isSubtype("pkcs7-signature") ||
+        ct->isSubtype("x-pkcs7-signature")) {
         return true;
     }
 
-    if (lowerSubType == "octet-stream") {
+    if (ct->isSubtype("octet-stream")) {
         const auto cd = content->contentDisposition();
         if (!cd) {
             return false;
         }
-        const auto fileName = cd->filename().toLower();
-        return fileName == QLatin1StringView("msg.asc") ||
-               fileName == QLatin1StringView("encrypted.asc");
+        const auto fileName = cd->filename();
+        return fileName.compare(QLatin1StringView("msg.asc"), Qt::CaseInsensitive) == 0 ||
+               fileName.compare(QLatin1StringView("encrypted.asc"), Qt::CaseInsensitive) == 0;
     }
 
     return false;
 }
 
-bool isAttachment(const Content* content)
+// isAttachment() with the lookup of the main body part and the result of
+// isCryptoPart() provided by the caller
+template <typename MainBodyPart>
+static bool isAttachment(const Content *content, MainBodyPart &&mainBodyPart, bool cryptoPart)
 {
-    if (!content) {
-        return false;
-    }
-
     const auto contentType = content->contentType();
     // multipart/* is never an attachment itself, message/rfc822 always is
     if (contentType) {
@@ -212,15 +212,12 @@ bool isAttachment(const Content* content)
     }
 
     // the main body part is not an attachment
-    if (content->parent()) {
-        const auto top = content->topLevel();
-        if (content == top->textContent()) {
-            return false;
-        }
+    if (content->parent() && content == mainBodyPart()) {
+        return false;
     }
 
     // ignore crypto parts
-    if (isCryptoPart(content)) {
+    if (cryptoPart) {
         return false;
     }
 
@@ -242,96 +239,199 @@ bool isAttachment(const Content* content)
     return false;
 }
 
-bool hasAttachment(const Content *content)
+bool isAttachment(const Content* content)
 {
     if (!content) {
         return false;
     }
+    return isAttachment(content, [content]() {
+        return content->topLevel()->textContent();
+    }, isCryptoPart(content));
+}
 
-    if (isAttachment(content)) {
-        return true;
+// The Content-Type subtypes of a message, or the mimetypes of one of its main
+// body parts, that make it signed or encrypted.
+static constexpr const char *signedSubtypes[] = {"signed", "pgp-signature", "pkcs7-signature", "x-pkcs7-signature"};
+static constexpr const char *signedMimeTypes[] = {"multipart/signed", "application/pgp-signature",
+                                                  "application/pkcs7-signature", "application/x-pkcs7-signature"};
+static constexpr const char *encryptedSubtypes[] = {"encrypted", "pgp-encrypted", "pkcs7-mime", "x-pkcs7-mime"};
+static constexpr const char *encryptedMimeTypes[] = {"multipart/encrypted", "application/pgp-encrypted",
+                                                     "application/pkcs7-mime", "application/x-pkcs7-mime"};
+
+static bool hasSubtype(const Headers::ContentType *ct, std::span<const char *const> subtypes)
+{
+    return ct && std::any_of(subtypes.begin(), subtypes.end(), [ct](const char *subtype) { return ct->isSubtype(subtype); });
+}
+
+static bool hasMimeType(const Content *c, std::span<const char *const> mimeTypes)
+{
+    const auto ct = c->contentType();
+    return ct && std::any_of(mimeTypes.begin(), mimeTypes.end(), [ct](const char *mimeType) { return ct->isMimeType(mimeType); });
+}
+
+PartClassifier::PartClassifier(const Content *root, PartRoles wanted)
+    : m_root(root)
+    , m_wanted(wanted)
+    , m_mainBodyPart(wanted.testAnyFlags(PartRole::Body | PartRole::Attachment) ? root->topLevel()->textContent() : nullptr)
+{
+}
+
+bool PartClassifier::isOnMainPath(const Content *c) const
+{
+    return m_mainPath && c->parent() == m_mainPath
+        && (m_mainPathAlternative || ContentPrivate::children(m_mainPath)[0] == c);
+}
+
+PartRoles PartClassifier::roles(const Content *c) const
+{
+    PartRoles roles;
+    if (c == m_mainBodyPart && m_wanted.testFlag(PartRole::Body)) {
+        roles |= PartRole::Body;
+    }
+    const bool attachment = !m_related && m_wanted.testFlag(PartRole::Attachment);
+    // needed for PartRole::Attachment as well, so only looked up once
+    const bool cryptoPart = (attachment || m_wanted.testFlag(PartRole::Crypto)) && isCryptoPart(c);
+    if (m_related) {
+        roles |= PartRole::RelatedInline;
+    } else if (attachment && isAttachment(c, [this]() { return m_mainBodyPart; }, cryptoPart)) {
+        roles |= PartRole::Attachment;
+    }
+    if (cryptoPart) {
+        roles |= PartRole::Crypto;
+    }
+    if (m_wanted.testFlag(PartRole::Invitation) && isInvitation(c)) {
+        roles |= PartRole::Invitation;
+    }
+    if (!m_wanted.testAnyFlags(PartRole::Signed | PartRole::Encrypted)) {
+        return roles & m_wanted;
     }
 
-    // OK, content itself is not an attachment. Now we deal with multiparts
-    const auto ct = content->contentType();
-    if (ct && ct->isMultipart() && !ct->isSubtype("related")) {// && !ct->isSubtype("alternative")) {
-        const auto contents = content->contents();
-        for (auto child : contents) {
-            if (hasAttachment(child)) {
-                return true;
+    // the same checks as hasMainBodyPartOfType(), done along the way
+    if (c == m_root) {
+        const auto ct = c->contentType();
+        if (hasSubtype(ct, signedSubtypes)) {
+            roles |= PartRole::Signed;
+        }
+        if (hasSubtype(ct, encryptedSubtypes)) {
+            roles |= PartRole::Encrypted;
+        }
+    } else if (isOnMainPath(c)) {
+        const auto ct = c->contentType();
+        if (m_mainPathAlternative || !ct || !ct->isMultipart()) {
+            if (hasMimeType(c, signedMimeTypes)) {
+                roles |= PartRole::Signed;
+            }
+            if (hasMimeType(c, encryptedMimeTypes)) {
+                roles |= PartRole::Encrypted;
             }
         }
     }
-    return false;
+    return roles & m_wanted;
 }
 
-bool hasInvitation(const Content *content)
+bool PartClassifier::enter(const Content *c)
 {
-    if (!content) {
+    const auto ct = c->contentType();
+    if (!ct || !ct->isMultipart()) {
         return false;
     }
+    if (!m_related && ct->isSubtype("related")) {
+        m_related = c;
+    }
+    if (c == m_root || (isOnMainPath(c) && !m_mainPathAlternative)) {
+        m_mainPath = c;
+        m_mainPathAlternative = ct->isSubtype("alternative");
+    }
+    return true;
+}
 
-    if (isInvitation(content)) {
-        return true;
+void PartClassifier::leave(const Content *c)
+{
+    if (c == m_related) {
+        m_related = nullptr;
     }
+}
 
-    // OK, content itself is not an invitation. Now we deal with multiparts
-    if (auto ct = content->contentType(); ct && ct->isMultipart()) {
-        const auto contents = content->contents();
-        for (auto child : contents) {
-            if (hasInvitation(child)) {
-                return true;
-            }
-        }
+bool hasAttachment(const Content *content)
+{
+    if (!content) {
+        return false;
     }
-    return false;
+
+    bool found = false;
+    classifyParts(content, PartRole::Attachment, [&found](const Content *, PartRoles roles) {
+        found = roles.testFlag(PartRole::Attachment);
+        return !found;
+    });
+    return found;
 }
 
-bool isSigned(const Message *message)
+bool hasInvitation(const Content *content)
 {
-    if (!message) {
+    if (!content) {
         return false;
     }
 
-    const KMime::Headers::ContentType *const contentType = message->contentType();
+    // look for an invitation, descending into multiparts only
+    return !ContentPrivate::walk(content, [](const Content *c) {
+        if (isInvitation(c)) {
+            return WalkResult::Stop;
+        }
+        const auto ct = c->contentType();
+        return ct && ct->isMultipart() ? WalkResult::Continue : WalkResult::SkipChildren;
+    });
+}
+
+// Whether the Content-Type of message has one of the given subtypes, or one
+// of its main body parts has one of the given mimetypes. This follows the
+// same path as Message::mainBodyPart(), but only once for all mimetypes.
+static bool hasMainBodyPartOfType(const Message *message,
+                                  std::span<const char *const> subtypes,
+                                  std::span<const char *const> mimeTypes)
+{
+    const auto contentType = message->contentType();
     if (!contentType) {
         return false;
     }
-    if (contentType->isSubtype("signed") ||
-            contentType->isSubtype("pgp-signature") ||
-            contentType->isSubtype("pkcs7-signature") ||
-            contentType->isSubtype("x-pkcs7-signature") ||
-            message->mainBodyPart("multipart/signed") ||
-            message->mainBodyPart("application/pgp-signature") ||
-            message->mainBodyPart("application/pkcs7-signature") ||
-            message->mainBodyPart("application/x-pkcs7-signature")) {
+    if (hasSubtype(contentType, subtypes)) {
         return true;
     }
-    return false;
+
+    const auto isCandidate = [mimeTypes](const Content *c) {
+        return hasMimeType(c, mimeTypes);
+    };
+    for (const Content *c = message;;) {
+        const auto ct = c->contentType();
+        if (!ct || !ct->isMultipart()) {
+            return isCandidate(c);
+        }
+        const auto children = ContentPrivate::children(c);
+        if (children.isEmpty()) {
+            return false;
+        }
+        if (ct->isSubtype("alternative")) {
+            return std::any_of(children.begin(), children.end(), isCandidate);
+        }
+        c = children[0];
+    }
 }
 
-bool isEncrypted(const Message *message)
+bool isSigned(const Message *message)
 {
     if (!message) {
         return false;
     }
 
-    const KMime::Headers::ContentType *const contentType = message->contentType();
-    if (!contentType) {
+    return hasMainBodyPartOfType(message, signedSubtypes, signedMimeTypes);
+}
+
+bool isEncrypted(const Message *message)
+{
+    if (!message) {
         return false;
     }
-    if (contentType->isSubtype("encrypted") ||
-            contentType->isSubtype("pgp-encrypted") ||
-            contentType->isSubtype("pkcs7-mime") ||
-            contentType->isSubtype("x-pkcs7-mime") ||
-            message->mainBodyPart("multipart/encrypted") ||
-            message->mainBodyPart("application/pgp-encrypted") ||
-            message->mainBodyPart("application/pkcs7-mime") ||
-            message->mainBodyPart("application/x-pkcs7-mime")) {
-        return true;
-    }
 
-    return false;
+    return hasMainBodyPartOfType(message, encryptedSubtypes, encryptedMimeTypes);
 }
 
 bool isInvitation(const Content *content)
@@ -341,7 +441,7 @@ bool isInvitation(const Content *content)
     }
 
     const KMime::Headers::ContentType *const contentType = content->contentType();
-    return contentType && contentType->isMediatype("text") && contentType->isSubtype("calendar");
+    return contentType && contentType->isMimeType("text/calendar");
 }
 
 } // namespace KMime
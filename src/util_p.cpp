@@ -6,8 +6,6 @@
   SPDX-License-Identifier: LGPL-2.0-or-later
 */
 
-#include <config-kmime.h>
-
 #include "util_p.h"
 #include "kmime_debug.h"
 
@@ -15,7 +13,9 @@
 #include <QChar>
 #include <QString>
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 
 using namespace KMime;
 
@@ -76,116 +76,164 @@ qsizetype KMime::findHeaderLineEnd(QByteArrayView src, qsizetype &dataBegin, boo
     return end;
 }
 
-#if !HAVE_STRCASESTR
-#ifdef WIN32
-#define strncasecmp _strnicmp
-#endif
-static const char *strcasestr(const char *haystack, const char *needle)
+bool KMime::nextHeaderField(QByteArrayView head, qsizetype &cursor, HeaderField &field)
 {
-    /* Copied from libreplace as part of qtwebengine 5.5.1 */
-    const char *s;
-    size_t nlen = strlen(needle);
-    for (s = haystack; *s; s++) {
-        if (toupper(*needle) == toupper(*s) && strncasecmp(s, needle, nlen) == 0) {
-            return (char *)((uintptr_t)s);
+    const char *colon = nullptr;
+    for (;;) {
+        if (cursor >= head.size()) {
+            return false;
+        }
+        const auto lineBegin = head.constData() + cursor;
+        colon = static_cast<const char *>(std::memchr(lineBegin, ':', head.size() - cursor));
+        if (!colon || colon == head.constData()) {
+            return false;
         }
+        // skip lines without a colon instead of making them part of the next field name
+        const auto lineEnd = static_cast<const char *>(std::memchr(lineBegin, '\n', colon - lineBegin));
+        if (!lineEnd) {
+            break;
+        }
+        cursor = lineEnd - head.constData() + 1;
+    }
+    field.name = QByteArrayView(head.constData() + cursor, colon);
+
+    qsizetype bodyBegin = colon - head.constData() + 1; // skip the ':'
+    if (bodyBegin < head.size() - 1 && head[bodyBegin] == ' ') { // skip the space after the ':', if there's any
+        ++bodyBegin;
     }
-    return NULL;
+    const auto bodyEnd = findHeaderLineEnd(head, bodyBegin, &field.folded);
+    field.body = QByteArrayView(head.constData() + bodyBegin, bodyEnd - bodyBegin);
+    cursor = bodyEnd + 1;
+    return true;
 }
-#endif
 
-qsizetype KMime::indexOfHeader(const QByteArray &src, const QByteArray &name, qsizetype &end, qsizetype &dataBegin, bool *folded)
+static QByteArray headerFieldValue(const HeaderField &field)
 {
-    QByteArray n = name;
-    n.append(':');
-    qsizetype begin = -1;
-
-    if (qstrnicmp(n.constData(), src.constData(), n.length()) == 0) {
-        begin = 0;
-    } else {
-        n.prepend('\n');
-        const char *p = strcasestr(src.constData(), n.constData());
-        if (!p) {
-            begin = -1;
-        } else {
-            begin = p - src.constData();
-            ++begin;
-        }
+    if (field.folded) {
+        return unfoldHeader(field.body.constData(), field.body.size());
     }
+    return field.body.toByteArray();
+}
 
-    if (begin > -1) {       //there is a header with the given name
-        dataBegin = begin + name.length() + 1; //skip the name
-        // skip the usual space after the colon
-        if (dataBegin < src.length() && src.at(dataBegin) == ' ') {
-            ++dataBegin;
+QByteArray KMime::extractHeader(QByteArrayView src, QByteArrayView name)
+{
+    qsizetype cursor = 0;
+    HeaderField field;
+    while (nextHeaderField(src, cursor, field)) {
+        if (field.name.compare(name, Qt::CaseInsensitive) == 0) {
+            return headerFieldValue(field);
         }
-        end = findHeaderLineEnd(src, dataBegin, folded);
-        return begin;
-
-    } else {
-        end = -1;
-        dataBegin = -1;
-        return -1; //header not found
     }
+    return {};
 }
 
-QByteArray KMime::extractHeader(const QByteArray &src, const QByteArray &name)
+// FNV-1a over the ASCII-lowercased name. Names are compared with Latin-1 case
+// folding, so non-ASCII bytes are left out rather than folded differently.
+static size_t fieldNameHash(QByteArrayView name)
 {
-    qsizetype begin;
-    qsizetype end;
-    bool folded;
-    QByteArray result;
+    size_t hash = 2166136261u;
+    for (const char ch : name) {
+        if (uchar(ch) < 0x80) {
+            hash = (hash ^ uchar(ch >= 'A' && ch <= 'Z' ? ch + 'a' - 'A' : ch)) * 16777619u;
+        }
+    }
+    return hash;
+}
 
-    if (src.isEmpty() || indexOfHeader(src, name, end, begin, &folded) < 0) {
-        return result;
+KMime::RawHeaderIndex::RawHeaderIndex(QByteArrayView head)
+{
+    qsizetype cursor = 0;
+    HeaderField field;
+    while (nextHeaderField(head, cursor, field)) {
+        m_fields.push_back(field);
     }
 
-    if (begin >= 0) {
-        if (!folded) {
-            result = src.mid(begin, end - begin);
-        } else {
-            if (end > begin) {
-                result = unfoldHeader(src.constData() + begin, end - begin);
+    // an open addressing table with linear probing, kept at most half full
+    qsizetype slotCount = 16;
+    while (slotCount < 2 * m_fields.size()) {
+        slotCount *= 2;
+    }
+    m_slots.resize(slotCount);
+    std::fill(m_slots.begin(), m_slots.end(), 0);
+    for (qsizetype i = 0; i < m_fields.size(); ++i) {
+        const auto name = m_fields[i].name;
+        for (auto slot = qsizetype(fieldNameHash(name) & size_t(slotCount - 1));; slot = (slot + 1) & (slotCount - 1)) {
+            if (m_slots[slot] == 0) {
+                m_slots[slot] = int(i + 1);
+                break;
+            }
+            if (m_fields[m_slots[slot] - 1].name.compare(name, Qt::CaseInsensitive) == 0) {
+                break; // the first field of a name wins, as with extractHeader()
             }
         }
     }
-    return result;
+}
+
+const HeaderField *KMime::RawHeaderIndex::find(QByteArrayView name) const
+{
+    const auto mask = m_slots.size() - 1;
+    for (auto slot = qsizetype(fieldNameHash(name) & size_t(mask)); m_slots[slot] != 0; slot = (slot + 1) & mask) {
+        const auto field = &m_fields[m_slots[slot] - 1];
+        if (field->name.compare(name, Qt::CaseInsensitive) == 0) {
+            return field;
+        }
+    }
+    return nullptr;
+}
+
+bool KMime::RawHeaderIndex::contains(QByteArrayView name) const
+{
+    return find(name);
+}
+
+QByteArray KMime::RawHeaderIndex::value(QByteArrayView name) const
+{
+    const auto field = find(name);
+    return field ? headerFieldValue(*field) : QByteArray();
 }
 
 QByteArray KMime::unfoldHeader(const char *header, size_t headerSize)
 {
     QByteArray result;
+    unfoldHeader(header, headerSize, result);
+    return result;
+}
+
+// the characters QChar::isSpace() accepts for a (signed) char
+static inline bool isFoldingSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+void KMime::unfoldHeader(const char *header, size_t headerSize, QByteArray &result)
+{
+    if (!result.isEmpty()) {
+        result.truncate(0); // keeps the capacity, unlike clear()
+    }
     if (headerSize == 0) {
-        return result;
+        return;
     }
 
     // unfolding skips characters so result will be at worst headerSize long
     result.reserve(headerSize);
 
-    const char *end = header + headerSize;
+    const char *const end = header + headerSize;
     const char *pos = header;
-    const char *foldBegin = nullptr;
-    const char *foldMid = nullptr;
-    const char *foldEnd = nullptr;
-    while ((foldMid = strchr(pos, '\n')) && foldMid < end) {
-        foldBegin = foldEnd = foldMid;
+    // memchr() is vectorized, and unlike strchr() doesn't read past the end
+    while (const char *foldMid = static_cast<const char *>(std::memchr(pos, '\n', end - pos))) {
         // find the first space before the line-break
-        while (foldBegin > header) {
-            if (!QChar::isSpace(*(foldBegin - 1))) {
-                break;
-            }
+        const char *foldBegin = foldMid;
+        while (foldBegin > header && isFoldingSpace(*(foldBegin - 1))) {
             --foldBegin;
         }
         // find the first non-space after the line-break
-        while (foldEnd <= end - 1) {
-            if (QChar::isSpace(*foldEnd)) {
+        const char *foldEnd = foldMid;
+        while (foldEnd < end) {
+            if (isFoldingSpace(*foldEnd)) {
                 ++foldEnd;
-            } else if (foldEnd && *(foldEnd - 1) == '\n' &&
-                       *foldEnd == '=' && foldEnd + 2 < (header + headerSize - 1) &&
-                       ((*(foldEnd + 1) == '0' &&
-                         *(foldEnd + 2) == '9') ||
-                        (*(foldEnd + 1) == '2' &&
-                         *(foldEnd + 2) == '0'))) {
+            } else if (*(foldEnd - 1) == '\n' && *foldEnd == '=' && foldEnd + 2 < end - 1 &&
+                       ((*(foldEnd + 1) == '0' && *(foldEnd + 2) == '9') ||
+                        (*(foldEnd + 1) == '2' && *(foldEnd + 2) == '0'))) {
                 // bug #86302: malformed header continuation starting with =09/=20
                 foldEnd += 3;
             } else {
@@ -202,7 +250,6 @@ QByteArray KMime::unfoldHeader(const char *header, size_t headerSize)
     if (end > pos) {
         result.append(pos, end - pos);
     }
-    return result;
 }
 
 QByteArray KMime::unfoldHeader(const QByteArray &header)
@@ -248,8 +295,11 @@ QByteArray KMime::foldHeader(const QByteArray &header)
         return header;
     }
 
-    // prepare for mutating header
-    QByteArray hdr = header;
+    // The folded header is assembled in a single pass, copying everything
+    // up to the next folding position at once. All positions below refer
+    // to the input.
+    QByteArray hdr;
+    qsizetype copied = 0;
 
     // There are positions that are eligible for inserting FWS but discouraged
     // (e.g. existing white space within a quoted string), and there are
@@ -263,49 +313,163 @@ QByteArray KMime::foldHeader(const QByteArray &header)
 
     HeaderContext ctx;
 
-    for (; true; ++pos) {
+    while (true) {
         if (pos - start > maxLen && eligible) {
             // Fold line preferably at recommended position, at eligible position
             // otherwise.
             const auto fws = recommended ? recommended : eligible;
-            hdr.insert(fws, '\n');
+            if (hdr.isEmpty()) {
+                hdr.reserve(header.length() + header.length() / maxLen + 1);
+            }
+            hdr.append(header.constData() + copied, fws - copied);
+            hdr += '\n';
+            copied = fws;
             // We started a new line, so reset.
             if (eligible <= fws) {
                 eligible = 0;
-            } else {
-                ++eligible; // LF
             }
             recommended = 0;
-            start = fws + 1/* LF */;
+            start = fws;
             continue;
         }
 
-        if (pos >= hdr.length()) {
+        if (pos >= header.length()) {
             break;
         }
 
+        const char c = header[pos];
         // account for already inserted FWS
         // (NOTE: we are not caring about broken ones here)
-        if (hdr[pos] == '\n') {
+        if (c == '\n') {
             recommended = eligible = 0;
             start = pos + 1/* LF */;
         }
 
         // Any white space character position is eligible for folding, except of
         // escape pair (i.e. BSP WSP must not be folded).
-        if (hdr[pos] == ' ' && !ctx.isEscapePair && hdr[pos - 1] != '\n') {
+        if (c == ' ' && !ctx.isEscapePair && header[pos - 1] != '\n') {
             eligible = pos;
-            if ((hdr[pos - 1] == ',' || hdr[pos - 1] == ';') && !ctx.isQuotedStr) {
+            if ((header[pos - 1] == ',' || header[pos - 1] == ';') && !ctx.isQuotedStr) {
                 recommended = pos;
             }
         }
 
-        ctx.push(hdr[pos]);
+        ctx.push(c);
+        ++pos;
     }
 
+    if (copied == 0) {
+        return header;
+    }
+    hdr.append(header.constData() + copied, header.length() - copied);
     return hdr;
 }
 
+qsizetype KMime::base64EncodedSize(qsizetype size, qsizetype *lineBreaks)
+{
+    // this has to match KCodecs::base64Encode(), which breaks lines after
+    // 76 characters but doesn't terminate the last line
+    const qsizetype encodedSize = ((size + 2) / 3) * 4;
+    const qsizetype breaks = encodedSize > 76 ? (encodedSize - 1) / 76 : 0;
+    if (lineBreaks) {
+        *lineBreaks = breaks;
+    }
+    return encodedSize + breaks;
+}
+
+qsizetype KMime::quotedPrintableEncodedSize(QByteArrayView data, qsizetype *lineBreaks)
+{
+    // this has to match KCodecs::quotedPrintableEncode() with useCRLF = false
+    constexpr qsizetype maxLineLength = 70;
+
+    qsizetype size = 0;
+    qsizetype breaks = 0;
+    qsizetype lineLength = 0;
+    const auto end = data.size() - 1;
+    for (qsizetype i = 0; i <= end; ++i) {
+        const auto c = static_cast<unsigned char>(data[i]);
+        qsizetype charSize = 3;
+        if (c >= 33 && c <= 126 && c != '=') {
+            charSize = 1;
+        } else if (c == ' ') {
+            // spaces are only encoded right before a line break
+            charSize = (i < end && data[i + 1] == '\n') ? 3 : 1;
+        } else if (c == '\n') {
+            charSize = 0;
+            ++size;
+            ++breaks;
+            lineLength = 0;
+        }
+        size += charSize;
+        lineLength += charSize;
+
+        // soft line break
+        if (lineLength > maxLineLength && i < end) {
+            size += 2;
+            ++breaks;
+            lineLength = 0;
+        }
+    }
+
+    if (lineBreaks) {
+        *lineBreaks = breaks;
+    }
+    return size;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+void KMime::quotedPrintableDecodeInPlace(QByteArray &data)
+{
+    // decoding never produces more output than it consumed input,
+    // so we can write the result over the already processed input
+    const auto length = data.size();
+    char *const begin = data.data();
+    char *out = begin;
+    for (qsizetype i = 0; i < length; ++i) {
+        const char c = begin[i];
+        if (c != '=') {
+            *out++ = c;
+            continue;
+        }
+        if (i >= length - 2) {
+            // incomplete escape sequence at the end, drop the '='
+            continue;
+        }
+
+        const char c1 = begin[i + 1];
+        const char c2 = begin[i + 2];
+        if (c1 == '\n') {
+            // soft line break
+            i += 1;
+        } else if (c1 == '\r' && c2 == '\n') {
+            i += 2;
+        } else if (const auto h1 = hexValue(c1), h2 = hexValue(c2); h1 >= 0 && h2 >= 0) {
+            *out++ = char(h1 * 16 + h2);
+            i += 2;
+        }
+        // otherwise this is an invalid escape sequence, drop the '='
+    }
+    data.truncate(out - begin);
+}
+
+bool KMime::isUsAscii(QByteArrayView s)
+{
+    return std::all_of(s.begin(), s.end(), [](char c) { return uchar(c) < 128; });
+}
+
 namespace
 {
 template < typename StringType, typename CharType > void removeQuotesGeneric(StringType &str)
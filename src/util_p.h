@@ -6,10 +6,10 @@
 
 #pragma once
 
-#include <qglobal.h>
+#include <QByteArrayView>
+#include <QVarLengthArray>
 
 class QByteArray;
-class QByteArrayView;
 class QString;
 
 #include <cstdlib>
@@ -37,6 +37,24 @@ namespace KMime
 */
 qsizetype findHeaderLineEnd(QByteArrayView src, qsizetype &dataBegin, bool *folded = nullptr);
 
+/**
+  A single field of a header block, as split off by nextHeaderField().
+  Both views point into the header block.
+*/
+struct HeaderField {
+    QByteArrayView name; ///< the raw field name, this may contain NUL bytes
+    QByteArrayView body; ///< the field body, still folded if @c folded is set
+    bool folded = false;
+};
+
+/**
+  Splits the header field starting at @p cursor off the header block @p head.
+  @param cursor the start of the field, moved past the end of the field on success
+  @param field the split off header field
+  @returns false if there are no further header fields
+*/
+[[nodiscard]] bool nextHeaderField(QByteArrayView head, qsizetype &cursor, HeaderField &field);
+
 /**
   Tries to extract the header with name @p name from the string
   @p src, unfolding it if necessary.
@@ -46,17 +64,41 @@ qsizetype findHeaderLineEnd(QByteArrayView src, qsizetype &dataBegin, bool *fold
 
   @return the first instance of the header @p name in @p src
           or a null QByteArray if no such header was found.
+  @see RawHeaderIndex
 */
-QByteArray extractHeader(const QByteArray &src, const QByteArray &name);
+QByteArray extractHeader(QByteArrayView src, QByteArrayView name);
 
 /**
-  Finds the first header of type @p name in @p src.
-  @param end The end index of the header.
-  @param dataBegin begin of the data part of the header, -1 if not found.
-  @param folded true if the headder is folded into multiple lines
-  @returns the begin index of the header, -1 if not found.
+  Index of the fields of a raw header block, for extracting several
+  headers without parsing the header block or rescanning it for
+  every lookup. The header block is tokenized once, lookups then
+  take constant time on average.
+  The indexed header block needs to outlive the index.
 */
-qsizetype indexOfHeader(const QByteArray &src, const QByteArray &name, qsizetype &end, qsizetype &dataBegin, bool *folded = nullptr);
+class RawHeaderIndex
+{
+public:
+    explicit RawHeaderIndex(QByteArrayView head);
+
+    /**
+      Returns whether the header block contains a field named @p name.
+    */
+    [[nodiscard]] bool contains(QByteArrayView name) const;
+
+    /**
+      Returns the unfolded body of the first field named @p name, same as
+      extractHeader(), or a null QByteArray if there is no such field.
+    */
+    [[nodiscard]] QByteArray value(QByteArrayView name) const;
+
+private:
+    [[nodiscard]] const HeaderField *find(QByteArrayView name) const;
+
+    QVarLengthArray<HeaderField, 16> m_fields;
+    // hash table over the case-insensitive field names, holding indexes
+    // into m_fields plus one, 0 marks an empty slot
+    QVarLengthArray<int, 32> m_slots;
+};
 
 /**
  *  Uses current time, pid and random numbers to construct a string
@@ -74,6 +116,10 @@ extern QByteArray uniqueString();
 */
 QByteArray unfoldHeader(const QByteArray &header);
 QByteArray unfoldHeader(const char *header, size_t headerSize);
+/**
+  Unfolds the given header into @p result, reusing its capacity.
+*/
+void unfoldHeader(const char *header, size_t headerSize, QByteArray &result);
 
 /**
   Folds the given header if necessary.
@@ -81,6 +127,37 @@ QByteArray unfoldHeader(const char *header, size_t headerSize);
 */
 QByteArray foldHeader(const QByteArray &header);
 
+/**
+  Returns the exact size of the output of KCodecs::base64Encode() with line
+  breaks inserted for @p size input bytes, without encoding anything.
+  @param size The size of the unencoded data.
+  @param lineBreaks If not @c nullptr, receives the number of line breaks in the output.
+*/
+[[nodiscard]] qsizetype base64EncodedSize(qsizetype size, qsizetype *lineBreaks = nullptr);
+
+/**
+  Returns the exact size of the output of KCodecs::quotedPrintableEncode()
+  with LF line breaks for @p data, without encoding anything.
+  @param data The unencoded data.
+  @param lineBreaks If not @c nullptr, receives the number of line breaks in the output.
+*/
+[[nodiscard]] qsizetype quotedPrintableEncodedSize(QByteArrayView data, qsizetype *lineBreaks = nullptr);
+
+/**
+  Decodes quoted-printable encoded data in place, the same way
+  KCodecs::quotedPrintableDecode() does. If @p data isn't shared,
+  the decoded data is written over the encoded data without any
+  further allocation.
+  @param data The data to decode.
+*/
+void quotedPrintableDecodeInPlace(QByteArray &data);
+
+/**
+  Returns whether @p s contains only US-ASCII characters, i.e. whether
+  it is valid UTF-8 and Latin-1 at the same time.
+*/
+[[nodiscard]] bool isUsAscii(QByteArrayView s);
+
 /**
   Removes quote (DQUOTE) characters and decodes "quoted-pairs"
   (ie. backslash-escaped characters)